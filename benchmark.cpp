@@ -0,0 +1,349 @@
+// Benchmark suite for the simulators. The simulator sources are compiled
+// in directly (SIMULATOR_NO_MAIN leaves out their main()), so the numbers
+// are for exactly the code the standalone programs run.
+//
+// Build: g++ -O2 -pthread benchmark.cpp -o benchmark
+// Run:   ./benchmark --sizes 1K,10K,100K,1M --runs 5 --csv bench.csv
+//
+// Every (subsystem, size) case runs in its own child process so the peak
+// RSS reported is that case's alone, and a crash or an out-of-memory at a
+// big size does not take the rest of the suite down.
+
+#define SIMULATOR_NO_MAIN
+#include "paging.cpp"
+#include "cpu_scheduling.cpp"
+#include "deadlock.cpp"
+#include "wordcount.cpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+// ==========================================
+// Synthetic inputs, same seed every run
+// ==========================================
+const uint64_t SEED = 12345;
+
+vector<int> pagingRefs;
+vector<Process> rrProcs;
+vector<int> deadlockE;
+vector<vector<int>> deadlockC, deadlockR;
+vector<string> wordLines;
+
+// Mostly a small hot set of pages that moves every few thousand references,
+// plus some uniformly random references, like a real program's working set
+void setupPaging(uint64_t n) {
+    mt19937_64 rng(SEED);
+    pagingRefs.resize(n);
+    int hotBase = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        if (i % 5000 == 0) hotBase = rng() % 1000;
+        if (rng() % 10 < 9) pagingRefs[i] = hotBase + rng() % 24;
+        else pagingRefs[i] = rng() % 1024;
+    }
+}
+
+long runPaging() {
+    return simulateAging(pagingRefs, 32);
+}
+
+// Processes arrive a few ticks apart with short bursts, sorted by arrival
+void setupRR(uint64_t n) {
+    mt19937_64 rng(SEED);
+    rrProcs.resize(n);
+    int arrival = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        rrProcs[i] = {(int)i + 1, arrival, 1 + (int)(rng() % 16)};
+        arrival += rng() % 3;
+    }
+}
+
+long runRR() {
+    return calculateRR(rrProcs, 4);
+}
+
+// n processes, 8 resource types, a little spare capacity
+void setupDeadlock(uint64_t n) {
+    mt19937_64 rng(SEED);
+    const int m = 8;
+    deadlockC.assign(n, vector<int>(m));
+    deadlockR.assign(n, vector<int>(m));
+    deadlockE.assign(m, 0);
+    for (uint64_t i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            deadlockC[i][j] = rng() % 4;
+            deadlockR[i][j] = rng() % 4;
+            deadlockE[j] += deadlockC[i][j];
+        }
+    }
+    for (int j = 0; j < m; j++) {
+        deadlockE[j] += 3;
+    }
+}
+
+long runDeadlock() {
+    vector<bool> finish = detectDeadlock(deadlockE, deadlockC, deadlockR);
+    return count(finish.begin(), finish.end(), true);
+}
+
+// n words in lines of 10, drawn from a skewed 5000-word vocabulary
+void setupWordCount(uint64_t n) {
+    mt19937_64 rng(SEED);
+    uniform_real_distribution<double> u(0.0, 1.0);
+    wordLines.clear();
+    string line;
+    for (uint64_t i = 0; i < n; i++) {
+        double x = u(rng);
+        line += "w" + to_string((int)(5000 * x * x * x)) + " ";
+        if (i % 10 == 9) {
+            wordLines.push_back(line);
+            line.clear();
+        }
+    }
+    if (!line.empty()) wordLines.push_back(line);
+}
+
+long runWordCount() {
+    return runWordCount(wordLines, 3).size();
+}
+
+struct Subsystem {
+    const char* name;
+    const char* function;
+    const char* unit;
+    void (*setup)(uint64_t);
+    long (*run)();
+};
+
+Subsystem subsystems[] = {
+    {"paging",    "simulateAging",  "references", setupPaging,    runPaging},
+    {"scheduler", "calculateRR",    "processes",  setupRR,        runRR},
+    {"deadlock",  "detectDeadlock", "processes",  setupDeadlock,  runDeadlock},
+    {"wordcount", "countWords",     "words",      setupWordCount, runWordCount},
+};
+
+// ==========================================
+// Measurement
+// ==========================================
+volatile long sink;   // keeps results alive so nothing is optimized away
+
+struct CaseResult {
+    bool ok;
+    vector<double> seconds;
+    long peakRssKb;
+    string error;
+};
+
+// Child: build the input, warm up, time 'runs' calls, send the times back
+CaseResult runCase(const Subsystem& sub, uint64_t n, int warmup, int runs, int timeout) {
+    CaseResult result;
+    result.ok = false;
+    result.peakRssKb = 0;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        result.error = strerror(errno);
+        return result;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        result.error = strerror(errno);
+        close(fds[0]);
+        close(fds[1]);
+        return result;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        // The simulators print progress, keep it out of the report
+        if (freopen("/dev/null", "w", stdout) == NULL) _exit(2);
+        if (timeout > 0) alarm(timeout);
+
+        sub.setup(n);
+        for (int i = 0; i < warmup; i++) {
+            sink = sub.run();
+        }
+        for (int i = 0; i < runs; i++) {
+            auto start = chrono::steady_clock::now();
+            sink = sub.run();
+            double s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (write(fds[1], &s, sizeof(s)) != sizeof(s)) _exit(3);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    double s;
+    while (read(fds[0], &s, sizeof(s)) == sizeof(s)) {
+        result.seconds.push_back(s);
+    }
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+    }
+    result.peakRssKb = usage.ru_maxrss;
+
+    if (WIFSIGNALED(status)) {
+        result.error = WTERMSIG(status) == SIGALRM ? "timed out" : strsignal(WTERMSIG(status));
+    } else if (WEXITSTATUS(status) != 0) {
+        result.error = "exit status " + to_string(WEXITSTATUS(status));
+    } else if ((int)result.seconds.size() != runs) {
+        result.error = "missing timings";
+    } else {
+        result.ok = true;
+    }
+    return result;
+}
+
+double median(vector<double> v) {
+    sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+double stddev(const vector<double>& v) {
+    if (v.size() < 2) return 0;
+    double mean = 0;
+    for (double x : v) mean += x;
+    mean /= v.size();
+    double sq = 0;
+    for (double x : v) sq += (x - mean) * (x - mean);
+    return sqrt(sq / (v.size() - 1));
+}
+
+// "1K", "10M", "1B" or a plain number
+uint64_t parseSize(const string& text) {
+    char* end;
+    double value = strtod(text.c_str(), &end);
+    switch (*end) {
+    case 'k': case 'K': value *= 1e3; break;
+    case 'm': case 'M': value *= 1e6; break;
+    case 'g': case 'G': case 'b': case 'B': value *= 1e9; break;
+    }
+    return (uint64_t)value;
+}
+
+vector<string> splitList(const string& text) {
+    vector<string> out;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == string::npos) comma = text.size();
+        if (comma > start) out.push_back(text.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return out;
+}
+
+void printUsage(const char* prog) {
+    cerr << "Usage: " << prog << " [options]" << endl;
+    cerr << "  --sizes LIST     input sizes, e.g. 1K,10K,1M,1B (default 1K,10K,100K)" << endl;
+    cerr << "  --runs N         timed runs per case (default 5)" << endl;
+    cerr << "  --warmup N       untimed runs first (default 1)" << endl;
+    cerr << "  --only LIST      subsystems to run: paging,scheduler,deadlock,wordcount" << endl;
+    cerr << "  --timeout S      give up on a case after S seconds (default: never)" << endl;
+    cerr << "  --csv FILE       append results to FILE instead of printing them" << endl;
+    cerr << "Note: calculateRR and detectDeadlock are quadratic, sizes past ~100K take long." << endl;
+}
+
+int main(int argc, char* argv[]) {
+    vector<uint64_t> sizes = {1000, 10000, 100000};
+    int runs = 5;
+    int warmup = 1;
+    int timeout = 0;
+    vector<string> only;
+    string csvFile;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+        string value = argv[++i];
+        if (arg == "--sizes") {
+            sizes.clear();
+            for (const string& s : splitList(value)) sizes.push_back(parseSize(s));
+        } else if (arg == "--runs") {
+            runs = atoi(value.c_str());
+        } else if (arg == "--warmup") {
+            warmup = atoi(value.c_str());
+        } else if (arg == "--only") {
+            only = splitList(value);
+        } else if (arg == "--timeout") {
+            timeout = atoi(value.c_str());
+        } else if (arg == "--csv") {
+            csvFile = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (runs < 1 || warmup < 0 || sizes.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    bool header = true;
+    if (!csvFile.empty()) {
+        out = fopen(csvFile.c_str(), "a");
+        if (out == NULL) {
+            perror(csvFile.c_str());
+            return 1;
+        }
+        header = ftell(out) == 0;
+    }
+    if (header) {
+        fprintf(out, "timestamp,subsystem,function,elements,unit,warmup,runs,"
+                     "median_s,stddev_s,min_s,throughput_per_s,peak_rss_kb\n");
+    }
+
+    long timestamp = time(NULL);
+    int failures = 0;
+
+    for (const Subsystem& sub : subsystems) {
+        if (!only.empty() && find(only.begin(), only.end(), sub.name) == only.end()) continue;
+
+        for (uint64_t n : sizes) {
+            cerr << sub.name << " (" << sub.function << ") n=" << n << " ... " << flush;
+            CaseResult r = runCase(sub, n, warmup, runs, timeout);
+            if (!r.ok) {
+                cerr << "FAILED: " << r.error << endl;
+                failures++;
+                continue;
+            }
+
+            double med = median(r.seconds);
+            double best = *min_element(r.seconds.begin(), r.seconds.end());
+            double throughput = med > 0 ? n / med : 0;
+            cerr << med << " s" << endl;
+
+            fprintf(out, "%ld,%s,%s,%llu,%s,%d,%d,%.6f,%.6f,%.6f,%.1f,%ld\n",
+                    timestamp, sub.name, sub.function, (unsigned long long)n, sub.unit,
+                    warmup, runs, med, stddev(r.seconds), best, throughput, r.peakRssKb);
+            fflush(out);
+        }
+    }
+
+    if (out != stdout) fclose(out);
+    return failures == 0 ? 0 : 1;
+}
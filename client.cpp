@@ -1,6 +1,14 @@
 #include <iostream>
 #include <thread>
 #include <cstring>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <set>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -9,47 +17,189 @@ using namespace std;
 
 #define PORT 8080
 #define BUFFER_SIZE 1024
+#define BACKOFF_START_MS 500
+#define BACKOFF_MAX_MS 30000
+#define DEFAULT_ROOM "general"
+#define SEEN_WINDOW 256
+
+atomic<int> current_sock(-1);
+
+// What the server confirmed so far, replayed after a reconnect.
+// Only the receiving thread touches these.
+uint64_t last_seen = 0;           // highest seq shown, or where we came in
+set<uint64_t> seen;               // the last SEEN_WINDOW seqs shown
+vector<string> rooms = {DEFAULT_ROOM};
+string current_room = DEFAULT_ROOM;
+
+int connect_to_server() {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in serv_addr;
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(PORT);
+    inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr);
+
+    if (connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+bool send_line(int sock, string line) {
+    line += "\n";
+    return send(sock, line.c_str(), line.size(), MSG_NOSIGNAL) == (ssize_t)line.size();
+}
+
+// Lines from two server threads can arrive out of order, @11 before
+// @10, so resume from the lowest gap among the recent ones. Replayed
+// lines that did arrive are dropped by track().
+uint64_t resume_point() {
+    for (auto it = seen.begin(); it != seen.end(); ++it) {
+        auto next = std::next(it);
+        if (next != seen.end() && *next != *it + 1) return *it;
+    }
+    return last_seen;
+}
+
+// Keep track of sequence numbers and room changes from the server's
+// lines. Returns false for a line that was shown already.
+bool track(int sock, const string& line) {
+    if (line[0] == '@') {
+        uint64_t seq = strtoull(line.c_str() + 1, nullptr, 10);
+        if (!seen.insert(seq).second) return false;
+        if (seen.size() > SEEN_WINDOW) seen.erase(seen.begin());
+        if (seq > last_seen) last_seen = seq;
+        return true;
+    }
+
+    string room;
+    if (line.rfind("* connected at @", 0) == 0) {
+        // Numbering restarted below what we saw: the server came back
+        // without its history, ask for what it has had since
+        uint64_t start = strtoull(line.c_str() + 16, nullptr, 10);
+        if (start < last_seen) {
+            seen.clear();
+            last_seen = 0;
+            send_line(sock, "/resume 0");
+        } else if (last_seen == 0) {
+            last_seen = start;
+        }
+    } else if (line.rfind("* resumed after @", 0) == 0) {
+        // A long gap comes in pieces
+        size_t more = line.find("more after @");
+        if (more != string::npos) send_line(sock, "/resume " + line.substr(more + 12));
+    } else if (line.rfind("* joined ", 0) == 0) {
+        room = line.substr(9);
+        current_room = room;
+    } else if (line.rfind("* subscribed to ", 0) == 0) {
+        room = line.substr(16);
+    } else if (line.rfind("* left ", 0) == 0) {
+        room = line.substr(7);
+        rooms.erase(remove(rooms.begin(), rooms.end(), room), rooms.end());
+        if (current_room == room) current_room = "";
+        return true;
+    }
+    if (!room.empty() && find(rooms.begin(), rooms.end(), room) == rooms.end()) {
+        rooms.push_back(room);
+    }
+    return true;
+}
+
+// Sequence numbers are bookkeeping, the user sees "[room] text"
+void show(const string& line) {
+    string text = line;
+    if (text[0] == '@') {
+        size_t space = text.find(' ');
+        text = space == string::npos ? "" : text.substr(space + 1);
+    }
+    cout << "\r" << text << "\n";
+}
+
+// Reconnect with exponential backoff plus jitter, then get back into the
+// same rooms and ask for everything sent in the meantime. Lines sent to
+// those rooms before the /resume arrive live and again in the replay,
+// track() drops the second copy.
+int reconnect() {
+    mt19937 rng(random_device{}());
+    int delay = BACKOFF_START_MS;
+    while (true) {
+        int wait = delay / 2 + rng() % (delay / 2 + 1);
+        cout << "\rConnection lost. Reconnecting in " << wait << " ms..." << endl;
+        this_thread::sleep_for(chrono::milliseconds(wait));
+
+        int sock = connect_to_server();
+        if (sock >= 0) {
+            // The server puts every new connection in the default room
+            bool ok = true;
+            for (const string& room : rooms) {
+                if (room != DEFAULT_ROOM && room != current_room) ok = ok && send_line(sock, "/subscribe " + room);
+            }
+            if (find(rooms.begin(), rooms.end(), DEFAULT_ROOM) == rooms.end()) {
+                ok = ok && send_line(sock, "/leave " DEFAULT_ROOM);
+            }
+            if (!current_room.empty()) ok = ok && send_line(sock, "/join " + current_room);
+            ok = ok && send_line(sock, "/resume " + to_string(resume_point()));
+            if (ok) {
+                cout << "Reconnected." << endl;
+                return sock;
+            }
+            close(sock);
+        }
+        delay = min(delay * 2, BACKOFF_MAX_MS);
+    }
+}
 
 void receive_messages(int sock) {
     char buffer[BUFFER_SIZE];
+    string pending;
     while (true) {
-        memset(buffer, 0, BUFFER_SIZE);
         int bytes_read = recv(sock, buffer, BUFFER_SIZE, 0);
         if (bytes_read > 0) {
-            
-            cout << "\r" << buffer << "\n> " << flush;
+            pending.append(buffer, bytes_read);
+            size_t start = 0, newline;
+            while ((newline = pending.find('\n', start)) != string::npos) {
+                string line = pending.substr(start, newline - start);
+                start = newline + 1;
+                if (line.empty()) continue;
+                if (track(sock, line)) show(line);
+            }
+            pending.erase(0, start);
+            cout << "> " << flush;
         } else {
-            cout << "\nConnection lost." << endl;
-            exit(0);
+            current_sock = -1;
+            close(sock);
+            pending.clear();
+            sock = reconnect();
+            current_sock = sock;
         }
     }
 }
 
 int main() {
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    sockaddr_in serv_addr;
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(PORT);
-    inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr);
-
-    if (connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
+    int sock = connect_to_server();
+    if (sock < 0) {
         cout << "Failed to connect to server." << endl;
         return -1;
     }
+    current_sock = sock;
 
     cout << "Successfully connected to the chat!" << endl;
 
-    
+
     thread(receive_messages, sock).detach();
 
     string input;
     while (true) {
         cout << "> ";
-        getline(cin, input);
-        if (input == "quit") break;
-        send(sock, input.c_str(), input.size(), 0);
+        if (!getline(cin, input) || input == "quit") break;
+
+        int s = current_sock;
+        if (s < 0 || !send_line(s, input)) {
+            cout << "(not connected, message not sent)" << endl;
+        }
     }
 
-    close(sock);
+    sock = current_sock;
+    if (sock >= 0) shutdown(sock, SHUT_RDWR);
     return 0;
-}
\ No newline at end of file
+}
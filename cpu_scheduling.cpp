@@ -141,6 +141,7 @@ float calculateRR(vector<Process> procs, int quantum) {
 // ==========================================
 // 5. Main Execution and Chart Output
 // ==========================================
+#ifndef SIMULATOR_NO_MAIN
 int main() {
     // Processes: {ID, Arrival Time, Burst Time}
     vector<Process> processes = {
@@ -183,4 +184,5 @@ int main() {
     cout << "(" << avgRR << ")\n\n";
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
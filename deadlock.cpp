@@ -5,34 +5,11 @@
 
 using namespace std;
 
-int main() {
-    ifstream file("input2.txt");
-    if (!file.is_open()) {
-        cout << "Error: Cannot open input2.txt" << endl;
-        return 0;
-    }
-
-    int n, m;
-    file >> n >> m;
-
-    vector<int> E(m);
-    for (int i = 0; i < m; i++) {
-        file >> E[i];
-    }
-
-    vector<vector<int>> C(n, vector<int>(m));
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < m; j++) {
-            file >> C[i][j];
-        }
-    }
-
-    vector<vector<int>> R(n, vector<int>(m));
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < m; j++) {
-            file >> R[i][j];
-        }
-    }
+// Reduction algorithm: repeatedly let a process whose requests can be met
+// finish and return its allocation. Whoever never finishes is deadlocked.
+vector<bool> detectDeadlock(const vector<int>& E, const vector<vector<int>>& C, const vector<vector<int>>& R) {
+    int n = C.size();
+    int m = E.size();
 
     vector<int> work(m);
     for (int j = 0; j < m; j++) {
@@ -86,6 +63,41 @@ int main() {
         }
     }
 
+    return finish;
+}
+
+#ifndef SIMULATOR_NO_MAIN
+int main() {
+    ifstream file("input2.txt");
+    if (!file.is_open()) {
+        cout << "Error: Cannot open input2.txt" << endl;
+        return 0;
+    }
+
+    int n, m;
+    file >> n >> m;
+
+    vector<int> E(m);
+    for (int i = 0; i < m; i++) {
+        file >> E[i];
+    }
+
+    vector<vector<int>> C(n, vector<int>(m));
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            file >> C[i][j];
+        }
+    }
+
+    vector<vector<int>> R(n, vector<int>(m));
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            file >> R[i][j];
+        }
+    }
+
+    vector<bool> finish = detectDeadlock(E, C, R);
+
     bool has_deadlock = false;
     
     cout << " System Status" << endl;
@@ -110,4 +122,5 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -9,20 +9,242 @@
 #include <dirent.h>
 #include <limits.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <string>
+#include <vector>
 
 using namespace std;
 
 // Needed for the 'environ' command 
 extern char **environ;
 
+// Job table
+// Every external command gets its own process group so the terminal can be
+// handed to it (fg) and Ctrl-C / Ctrl-Z only hit that job, not the shell.
+enum JobState { JOB_RUNNING, JOB_STOPPED, JOB_DONE };
+
+struct Job {
+    int id;
+    pid_t pgid;
+    JobState state;
+    bool background;   // started with '&' -> report when it finishes
+    bool batchSlot;    // counts against the -j N limit
+    string command;
+};
+
+vector<Job> jobs;
+int nextJobId = 1;
+
+bool interactive = false;
+pid_t shell_pgid;
+
+// SIGCHLD is blocked and read from a signalfd that is polled together with
+// stdin, so children are reaped as soon as they exit, even while the shell
+// sits at the prompt. The waitpid() calls all happen in the main loop, so
+// the foreground wait never races with a handler for a child.
+int sigchld_fd = -1;
+sigset_t orig_mask;     // restored in children before exec
+
+Job* findJob(pid_t pgid) {
+    for (size_t k = 0; k < jobs.size(); k++) {
+        if (jobs[k].pgid == pgid) return &jobs[k];
+    }
+    return NULL;
+}
+
+// "%2", "2" or nothing (= most recent job)
+Job* parseJobSpec(const char* spec) {
+    if (jobs.empty()) return NULL;
+    if (spec == NULL) return &jobs.back();
+    if (spec[0] == '%') spec++;
+    int id = atoi(spec);
+    for (size_t k = 0; k < jobs.size(); k++) {
+        if (jobs[k].id == id) return &jobs[k];
+    }
+    return NULL;
+}
+
+void updateJob(pid_t pid, int status) {
+    Job* job = findJob(pid);
+    if (job == NULL) return;
+
+    if (WIFSTOPPED(status)) {
+        job->state = JOB_STOPPED;
+    } else if (WIFCONTINUED(status)) {
+        job->state = JOB_RUNNING;
+    } else {
+        job->state = JOB_DONE;
+    }
+}
+
+// Drop finished jobs, telling the user about background ones.
+// Returns true if anything was printed.
+bool cleanupJobs() {
+    bool reported = false;
+    for (size_t k = 0; k < jobs.size(); ) {
+        if (jobs[k].state == JOB_DONE) {
+            if (jobs[k].background) {
+                cout << "[" << jobs[k].id << "] Done\t" << jobs[k].command << endl;
+                reported = true;
+            }
+            jobs.erase(jobs.begin() + k);
+        } else {
+            k++;
+        }
+    }
+    if (jobs.empty()) nextJobId = 1;
+    return reported;
+}
+
+// Collect every child that changed state without blocking.
+bool reapChildren() {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0) {
+        updateJob(pid, status);
+    }
+    return cleanupJobs();
+}
+
+// Empty the signalfd, true if a SIGCHLD came in since the last call
+bool childChanged() {
+    struct signalfd_siginfo info;
+    bool changed = false;
+    while (read(sigchld_fd, &info, sizeof(info)) == sizeof(info)) {
+        changed = true;
+    }
+    return changed;
+}
+
+char in_buf[4096];
+size_t in_len = 0, in_pos = 0;
+
+// Reads one line from stdin (without the newline), reaping children
+// whenever SIGCHLD arrives meanwhile. Reads fd 0 directly rather than
+// through cin, whose buffer poll() cannot see. Longer lines are cut to
+// size - 1. Returns false at end of input.
+bool readLine(char* line, size_t size, const char* prompt) {
+    size_t n = 0;
+    while (true) {
+        if (childChanged() && reapChildren() && prompt != NULL) {
+            cout << prompt << flush;
+        }
+
+        while (in_pos < in_len) {
+            char c = in_buf[in_pos++];
+            if (c == '\n') {
+                line[n] = '\0';
+                return true;
+            }
+            if (n + 1 < size) line[n++] = c;
+        }
+
+        struct pollfd fds[2];
+        fds[0].fd = STDIN_FILENO;
+        fds[0].events = POLLIN;
+        fds[1].fd = sigchld_fd;
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (fds[0].revents == 0) continue;
+
+        ssize_t r = read(STDIN_FILENO, in_buf, sizeof(in_buf));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) {
+            // A last line without a newline still counts
+            line[n] = '\0';
+            return n > 0;
+        }
+        in_len = r;
+        in_pos = 0;
+    }
+}
+
+// Block until this job finishes or stops. Waits on the job's own pid so a
+// background child can never be reaped by mistake.
+void waitForJob(Job* job, bool foreground) {
+    pid_t pgid = job->pgid;
+
+    if (foreground && interactive) {
+        tcsetpgrp(STDIN_FILENO, pgid);
+    }
+
+    int status;
+    while (true) {
+        pid_t r = waitpid(pgid, &status, WUNTRACED);
+        if (r == pgid) {
+            updateJob(pgid, status);
+            break;
+        }
+        if (r < 0 && errno != EINTR) {
+            // Already reaped elsewhere
+            job->state = JOB_DONE;
+            break;
+        }
+    }
+
+    if (foreground && interactive) {
+        tcsetpgrp(STDIN_FILENO, shell_pgid);
+    }
+
+    job = findJob(pgid);
+    if (job != NULL && job->state == JOB_STOPPED) {
+        cout << endl << "[" << job->id << "] Stopped\t" << job->command << endl;
+        job->background = true;
+    } else if (job != NULL && foreground) {
+        // Nobody needs to be told about a job the user just waited for
+        job->background = false;
+    }
+    cleanupJobs();
+}
+
+int runningSlots() {
+    int count = 0;
+    for (size_t k = 0; k < jobs.size(); k++) {
+        if (jobs[k].batchSlot && jobs[k].state != JOB_DONE) count++;
+    }
+    return count;
+}
+
+// Wait until at most 'limit' batch lines are still running (-j mode).
+void waitForSlots(int limit) {
+    while (runningSlots() > limit) {
+        int status;
+        pid_t pid = waitpid(-1, &status, WUNTRACED);
+        if (pid > 0) {
+            updateJob(pid, status);
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    cleanupJobs();
+}
+
 int main(int argc, char *argv[]) {
     char input[1024];
     char cwd[PATH_MAX];
     char *args[64]; 
+    int max_parallel = 1;
+    const char *batch_file = NULL;
+
+    // Usage: myshell [-j N] [batchfile]
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) {
+            max_parallel = atoi(argv[++a]);
+            if (max_parallel < 1) max_parallel = 1;
+        } else {
+            batch_file = argv[a];
+        }
+    }
     
     // Support batch file mode 
-    if (argc == 2) {
-        int fd = open(argv[1], O_RDONLY);
+    if (batch_file != NULL) {
+        int fd = open(batch_file, O_RDONLY);
         if (fd < 0) {
             perror("Error opening batch file");
             return 1;
@@ -31,25 +253,53 @@ int main(int argc, char *argv[]) {
         close(fd);
     }
 
+    // -j only makes sense for batch files, keep interactive use serial
+    if (batch_file == NULL) max_parallel = 1;
+
+    sigset_t chld_mask;
+    sigemptyset(&chld_mask);
+    sigaddset(&chld_mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld_mask, &orig_mask);
+    sigchld_fd = signalfd(-1, &chld_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sigchld_fd < 0) {
+        perror("signalfd");
+        return 1;
+    }
+
+    // Take over the terminal when running interactively
+    interactive = isatty(STDIN_FILENO);
+    if (interactive) {
+        signal(SIGINT, SIG_IGN);
+        signal(SIGQUIT, SIG_IGN);
+        signal(SIGTSTP, SIG_IGN);
+        signal(SIGTTIN, SIG_IGN);
+        signal(SIGTTOU, SIG_IGN);
+
+        shell_pgid = getpid();
+        setpgid(shell_pgid, shell_pgid);
+        tcsetpgrp(STDIN_FILENO, shell_pgid);
+    }
+
     
     if (getcwd(cwd, sizeof(cwd)) != NULL) {
         setenv("PWD", cwd, 1);
     }
 
     while (true) {
-       
+        string prompt = "? > ";
         if (getcwd(cwd, sizeof(cwd)) != NULL) {
-             cout << cwd << " > "; 
-        } else {
-             cout << "? > ";
+             prompt = string(cwd) + " > ";
         }
+        cout << prompt << flush;
 
         //  Read Input
         
-        if (!cin.getline(input, 1024)) {
+        if (!readLine(input, sizeof(input), prompt.c_str())) {
             break; 
         }
 
+        string line = input;
+
         //  Parse Input (Tokenize spaces)
         int i = 0;
         char *token = strtok(input, " \t\n");
@@ -62,6 +312,18 @@ int main(int argc, char *argv[]) {
 
         if (args[0] == NULL) continue; 
 
+        // Builtins change shell state, so in -j mode earlier lines must be
+        // finished before one of them runs.
+        bool builtin = strcmp(args[0], "cd") == 0 || strcmp(args[0], "quit") == 0 ||
+                       strcmp(args[0], "dir") == 0 || strcmp(args[0], "environ") == 0 ||
+                       strcmp(args[0], "set") == 0 || strcmp(args[0], "echo") == 0 ||
+                       strcmp(args[0], "help") == 0 || strcmp(args[0], "pause") == 0 ||
+                       strcmp(args[0], "jobs") == 0 || strcmp(args[0], "fg") == 0 ||
+                       strcmp(args[0], "bg") == 0 || strcmp(args[0], "wait") == 0;
+        if (builtin && max_parallel > 1) {
+            waitForSlots(0);
+        }
+
         
         int background = 0;
         char *file_in = NULL;
@@ -110,6 +372,61 @@ int main(int argc, char *argv[]) {
             break;
         }
 
+        // 'jobs' command
+        if (strcmp(args[0], "jobs") == 0) {
+            reapChildren();
+            for (size_t k = 0; k < jobs.size(); k++) {
+                cout << "[" << jobs[k].id << "] " << jobs[k].pgid << " "
+                     << (jobs[k].state == JOB_STOPPED ? "Stopped" : "Running")
+                     << "\t" << jobs[k].command << endl;
+            }
+            continue;
+        }
+
+        // 'fg' and 'bg' commands
+        if (strcmp(args[0], "fg") == 0 || strcmp(args[0], "bg") == 0) {
+            Job* job = parseJobSpec(args[1]);
+            if (job == NULL) {
+                cout << args[0] << ": no such job" << endl;
+                continue;
+            }
+            bool foreground = strcmp(args[0], "fg") == 0;
+            cout << job->command << endl;
+            job->state = JOB_RUNNING;
+            job->background = !foreground;
+            kill(-job->pgid, SIGCONT);
+            if (foreground) {
+                waitForJob(job, true);
+            }
+            continue;
+        }
+
+        // 'wait' command
+        if (strcmp(args[0], "wait") == 0) {
+            if (args[1] != NULL) {
+                Job* job = parseJobSpec(args[1]);
+                if (job == NULL) {
+                    cout << "wait: no such job" << endl;
+                } else {
+                    waitForJob(job, false);
+                }
+            } else {
+                // Stopped jobs would block forever, only wait for running ones
+                while (true) {
+                    Job* job = NULL;
+                    for (size_t k = 0; k < jobs.size(); k++) {
+                        if (jobs[k].state == JOB_RUNNING) {
+                            job = &jobs[k];
+                            break;
+                        }
+                    }
+                    if (job == NULL) break;
+                    waitForJob(job, false);
+                }
+            }
+            continue;
+        }
+
         // 'dir' command 
         if (strcmp(args[0], "dir") == 0) {
             const char* path = ".";
@@ -160,14 +477,16 @@ int main(int argc, char *argv[]) {
         if (strcmp(args[0], "help") == 0) {
              cout << "Shell Manual:" << endl;
              cout << "cd, dir, environ, set, echo, help, pause, quit" << endl;
+             cout << "jobs, fg [%n], bg [%n], wait [%n]" << endl;
              cout << "Supports < > >> redirection and & background." << endl;
+             cout << "Batch mode: myshell [-j N] file runs up to N lines at once." << endl;
              continue;
         }
 
         // 'pause' command
         if (strcmp(args[0], "pause") == 0) {
             char dump[10];
-            cin.getline(dump, 10); // Wait for enter
+            readLine(dump, sizeof(dump), NULL); // Wait for enter
             continue;
         }
 
@@ -181,6 +500,18 @@ int main(int argc, char *argv[]) {
         }
         else if (pid == 0) {
             // Child Process
+
+            // Own process group, default signal handling again
+            setpgid(0, 0);
+            if (interactive && background == 0 && max_parallel == 1) {
+                tcsetpgrp(STDIN_FILENO, getpid());
+            }
+            signal(SIGINT, SIG_DFL);
+            signal(SIGQUIT, SIG_DFL);
+            signal(SIGTSTP, SIG_DFL);
+            signal(SIGTTIN, SIG_DFL);
+            signal(SIGTTOU, SIG_DFL);
+            sigprocmask(SIG_SETMASK, &orig_mask, NULL);
             
             // Handle IO Redirection inside child
             if (file_in) {
@@ -208,11 +539,30 @@ int main(int argc, char *argv[]) {
         }
         else {
             // Parent Process
-            if (background == 0) {
-                wait(NULL); 
+            setpgid(pid, pid);
+
+            Job job;
+            job.id = nextJobId++;
+            job.pgid = pid;
+            job.state = JOB_RUNNING;
+            job.background = background;
+            job.batchSlot = background == 0 && max_parallel > 1;
+            job.command = line;
+            jobs.push_back(job);
+
+            if (background) {
+                cout << "[" << job.id << "] " << pid << endl;
+            } else if (job.batchSlot) {
+                // -j mode: keep going until all N slots are busy
+                waitForSlots(max_parallel - 1);
+            } else {
+                waitForJob(&jobs.back(), true);
             }
         }
     }
 
+    // Let batch lines that are still running finish
+    waitForSlots(0);
+
     return 0;
 }
@@ -67,6 +67,7 @@ int simulateAging(const vector<int>& references, int numFrames) {
     return pageFaults;
 }
 
+#ifndef SIMULATOR_NO_MAIN
 int main() {
     
     ifstream inputFile("references.txt");
@@ -113,4 +114,5 @@ int main() {
     cout << "Results saved to 'results.csv'. You can open this in Excel to plot the graph." << endl;
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,510 @@
+// Trace-driven pipeline: the Round Robin scheduler decides which process
+// runs, and the paging simulator sees that process's page references.
+// All processes share one fixed pool of frames, so the study shows how the
+// quantum trades waiting time against page faults.
+//
+// Build: g++ -O2 -pthread pipeline.cpp -o pipeline
+// Run:   ./pipeline --procs 10000 --frames 512 --quanta 1,2,4,8,16,32,64 --csv quantum.csv
+//
+// Per quantum, one thread walks the scheduler's timeline and expands each
+// tick into references, another runs the pager. They meet in a fixed set
+// of blocks handed back and forth, so nothing goes through a file and
+// memory does not depend on how long the run is.
+
+#define SIMULATOR_NO_MAIN  // leave out the simulators' own main()
+#include "cpu_scheduling.cpp"
+#include "paging.cpp"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+
+using namespace std;
+
+#define BLOCK_REFS 4096
+#define QUEUE_BLOCKS 16
+
+#define PROC_PAGES 1024       // pages in each synthetic address space
+#define HOT_PAGES 24          // working set
+#define HOT_PERCENT 90
+#define PHASE_REFS 5000       // the working set moves this often
+
+#define ARRIVAL_GAP 220       // ticks between arrivals, up to (load about 0.9)
+#define MAX_BURST 200         // ticks of CPU per process, up to
+
+const uint64_t TICK = UINT64_MAX;   // clock interrupt marker in the stream
+
+// ==========================================
+// 1. Workload
+// ==========================================
+uint64_t splitmix(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Sorted by arrival, which calculateRR expects too
+vector<Process> makeProcesses(int n, uint64_t seed) {
+    vector<Process> procs(n);
+    uint64_t rng = seed;
+    int arrival = 0;
+    for (int i = 0; i < n; i++) {
+        procs[i] = {i + 1, arrival, 1 + (int)(splitmix(rng) % MAX_BURST)};
+        arrival += splitmix(rng) % ARRIVAL_GAP;
+    }
+    return procs;
+}
+
+// Each process has its own reference stream, produced on demand from a
+// few bytes of state. Synthetic streams keep a small hot set that moves
+// now and then. With a recording every process replays it from its own
+// starting point, like many copies of the same program.
+struct RefStream {
+    uint64_t rng;
+    uint32_t pos;
+    int hotBase;
+    int phaseLeft;
+};
+
+class RefSource {
+public:
+    RefSource(int n, uint64_t seed, const vector<int>* recorded) : recorded(recorded), streams(n) {
+        for (int i = 0; i < n; i++) {
+            streams[i].rng = seed ^ ((uint64_t)(i + 1) * 0x2545f4914f6cdd1dULL);
+            streams[i].pos = recorded ? ((uint64_t)i * 7919) % recorded->size() : 0;
+            streams[i].hotBase = 0;
+            streams[i].phaseLeft = 0;
+        }
+    }
+
+    int next(int proc) {
+        RefStream& s = streams[proc];
+        if (recorded) {
+            int page = (*recorded)[s.pos];
+            if (++s.pos == recorded->size()) s.pos = 0;
+            return page;
+        }
+        if (s.phaseLeft == 0) {
+            s.hotBase = splitmix(s.rng) % (PROC_PAGES - HOT_PAGES);
+            s.phaseLeft = PHASE_REFS;
+        }
+        s.phaseLeft--;
+        uint64_t r = splitmix(s.rng);
+        if (r % 100 < HOT_PERCENT) return s.hotBase + (r >> 8) % HOT_PAGES;
+        return (r >> 8) % PROC_PAGES;
+    }
+
+private:
+    const vector<int>* recorded;
+    vector<RefStream> streams;
+};
+
+// Address spaces are separate: the same page number in two processes
+// is two different pages
+uint64_t pageKey(int proc, int page) {
+    return ((uint64_t)proc << 32) | (uint32_t)page;
+}
+
+// ==========================================
+// 2. Bounded hand-off between the stages
+// ==========================================
+class BlockQueue {
+public:
+    void push(vector<uint64_t>&& block) {
+        {
+            lock_guard<mutex> guard(lock);
+            blocks.push_back(move(block));
+        }
+        ready.notify_one();
+    }
+
+    // False once the queue is closed and drained
+    bool pop(vector<uint64_t>& block) {
+        unique_lock<mutex> guard(lock);
+        ready.wait(guard, [this] { return !blocks.empty() || closed; });
+        if (blocks.empty()) return false;
+        block = move(blocks.front());
+        blocks.pop_front();
+        return true;
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> guard(lock);
+            closed = true;
+        }
+        ready.notify_all();
+    }
+
+private:
+    mutex lock;
+    condition_variable ready;
+    deque<vector<uint64_t>> blocks;
+    bool closed = false;
+};
+
+// QUEUE_BLOCKS blocks circulate between 'empty' and 'full', the producer
+// waits for the pager when they are all full
+struct Pipe {
+    BlockQueue full, empty;
+
+    Pipe() {
+        for (int i = 0; i < QUEUE_BLOCKS; i++) {
+            vector<uint64_t> block;
+            block.reserve(BLOCK_REFS);
+            empty.push(move(block));
+        }
+    }
+};
+
+// ==========================================
+// 3. Scheduler stage
+// ==========================================
+struct ScheduleStats {
+    long dispatches = 0;
+    long ticks = 0;
+    double avgWait = 0;
+};
+
+// Round Robin decided exactly like calculateRR, but every tick is
+// streamed out as it happens: a TICK marker, then the references the
+// running process makes in it. Idle ticks are just the marker.
+void runScheduler(const vector<Process>& procs, int quantum, int refsPerTick,
+                  RefSource& source, Pipe& pipe, ScheduleStats& stats) {
+    vector<uint64_t> block;
+    pipe.empty.pop(block);
+    auto emit = [&](uint64_t value) {
+        block.push_back(value);
+        if (block.size() == BLOCK_REFS) {
+            pipe.full.push(move(block));
+            pipe.empty.pop(block);
+        }
+    };
+    auto runTicks = [&](int proc, int ticks) {
+        for (int t = 0; t < ticks; t++) {
+            emit(TICK);
+            for (int r = 0; r < refsPerTick && proc >= 0; r++) {
+                emit(pageKey(proc, source.next(proc)));
+            }
+        }
+        stats.ticks += ticks;
+    };
+
+    int n = procs.size();
+    vector<int> remainingBurst(n);
+    for (int i = 0; i < n; i++) {
+        remainingBurst[i] = procs[i].burstTime;
+    }
+
+    // Sorted input, so "everyone who arrived and was not queued yet" is
+    // everyone before the next unadmitted one
+    int currentTime = procs[0].arrivalTime;
+    deque<int> queue = {0};
+    int admitted = 1;
+    int completedCount = 0;
+    double totalWait = 0;
+
+    while (completedCount < n) {
+        if (queue.empty()) {
+            int idleUntil = max(currentTime + 1, procs[admitted].arrivalTime);
+            runTicks(-1, idleUntil - currentTime);
+            currentTime = idleUntil;
+            while (admitted < n && procs[admitted].arrivalTime <= currentTime) {
+                queue.push_back(admitted++);
+            }
+            continue;
+        }
+
+        int i = queue.front();
+        queue.pop_front();
+        stats.dispatches++;
+
+        int slice = min(quantum, remainingBurst[i]);
+        runTicks(i, slice);
+        currentTime += slice;
+        remainingBurst[i] -= slice;
+        if (remainingBurst[i] == 0) {
+            totalWait += currentTime - procs[i].arrivalTime - procs[i].burstTime;
+            completedCount++;
+        }
+
+        while (admitted < n && procs[admitted].arrivalTime <= currentTime) {
+            queue.push_back(admitted++);
+        }
+        if (remainingBurst[i] > 0) {
+            queue.push_back(i);
+        }
+    }
+
+    if (!block.empty()) pipe.full.push(move(block));
+    pipe.full.close();
+    stats.avgWait = totalWait / n;
+}
+
+// ==========================================
+// 4. Pager stage
+// ==========================================
+// simulateAging's policy on a pool shared by every process: a reference
+// sets the top bit of the page's counter, the counters shift right on
+// every clock tick, and a fault evicts the lowest counter. With one
+// reference per tick this is simulateAging step for step.
+class FramePool {
+public:
+    long faults = 0;
+    long references = 0;
+
+    explicit FramePool(int numFrames) : numFrames(numFrames) {
+        keys.reserve(numFrames);
+        counters.reserve(numFrames);
+        where.reserve(numFrames * 2);
+    }
+
+    void tick() {
+        for (unsigned char& counter : counters) {
+            counter = counter >> 1;
+        }
+    }
+
+    void access(uint64_t key) {
+        references++;
+        auto found = where.find(key);
+        if (found != where.end()) {
+            counters[found->second] |= 128;
+            return;
+        }
+
+        faults++;
+        if ((int)keys.size() < numFrames) {
+            where[key] = keys.size();
+            keys.push_back(key);
+            counters.push_back(128);
+            return;
+        }
+
+        int evictIndex = 0;
+        unsigned char minCounter = 255;
+        for (int j = 0; j < numFrames; j++) {
+            if (counters[j] < minCounter) {
+                minCounter = counters[j];
+                evictIndex = j;
+            }
+        }
+        where.erase(keys[evictIndex]);
+        keys[evictIndex] = key;
+        counters[evictIndex] = 128;
+        where[key] = evictIndex;
+    }
+
+private:
+    int numFrames;
+    vector<uint64_t> keys;               // page in each frame
+    vector<unsigned char> counters;
+    unordered_map<uint64_t, int> where;  // page -> frame
+};
+
+void runPager(FramePool& pool, Pipe& pipe) {
+    vector<uint64_t> block;
+    while (pipe.full.pop(block)) {
+        for (uint64_t value : block) {
+            if (value == TICK) pool.tick();
+            else pool.access(value);
+        }
+        block.clear();
+        pipe.empty.push(move(block));
+    }
+}
+
+// ==========================================
+// 5. One run per quantum
+// ==========================================
+struct RunResult {
+    ScheduleStats schedule;
+    long references;
+    long faults;
+    double seconds;
+};
+
+RunResult runPipeline(const vector<Process>& procs, int quantum, int frames, int refsPerTick,
+                      const vector<int>* recorded, uint64_t seed) {
+    auto start = chrono::steady_clock::now();
+    RefSource source(procs.size(), seed, recorded);
+    Pipe pipe;
+    FramePool pool(frames);
+    RunResult result;
+
+    thread scheduler(runScheduler, cref(procs), quantum, refsPerTick, ref(source), ref(pipe), ref(result.schedule));
+    runPager(pool, pipe);
+    scheduler.join();
+
+    result.references = pool.references;
+    result.faults = pool.faults;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// The pipeline against the standalone simulators: the same waiting times
+// as calculateRR, and with one process making one reference per tick the
+// same faults as simulateAging
+bool runChecks(const vector<int>* recorded, uint64_t seed) {
+    bool ok = true;
+    vector<Process> procs = makeProcesses(500, seed);
+    for (int quantum : {1, 3, 8, 50}) {
+        double expected = calculateRR(procs, quantum);
+        double got = runPipeline(procs, quantum, 64, 1, recorded, seed).schedule.avgWait;
+        if (fabs(got - expected) > 1e-3 * max(1.0, fabs(expected))) {
+            cout << "check: quantum " << quantum << " waits " << got << ", calculateRR says " << expected << endl;
+            ok = false;
+        }
+    }
+
+    vector<Process> single = {{1, 0, 20000}};
+    RefSource source(1, seed, recorded);
+    vector<int> references;
+    for (int i = 0; i < single[0].burstTime; i++) {
+        references.push_back(source.next(0));
+    }
+    for (int frames : {1, 8, 32, 100}) {
+        long expected = simulateAging(references, frames);
+        long got = runPipeline(single, 7, frames, 1, recorded, seed).faults;
+        if (got != expected) {
+            cout << "check: " << frames << " frames fault " << got << " times, simulateAging says " << expected << endl;
+            ok = false;
+        }
+    }
+
+    cout << (ok ? "check: pipeline agrees with calculateRR and simulateAging" : "check: FAILED") << endl;
+    return ok;
+}
+
+// ==========================================
+// 6. Main
+// ==========================================
+vector<int> splitInts(const string& text) {
+    vector<int> out;
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(atoi(item.c_str()));
+    }
+    return out;
+}
+
+void printUsage(const char* prog) {
+    cerr << "Usage: " << prog << " [options]" << endl;
+    cerr << "  --procs N          processes (default 1000)" << endl;
+    cerr << "  --frames N         frames shared by all processes (default 256)" << endl;
+    cerr << "  --quanta LIST      Round Robin quanta to compare (default 1,2,4,8,16,32,64)" << endl;
+    cerr << "  --refs-per-tick N  page references per clock tick (default 16)" << endl;
+    cerr << "  --refs FILE        replay recorded references (like references.txt) instead of synthetic ones" << endl;
+    cerr << "  --seed N           workload seed (default 12345)" << endl;
+    cerr << "  --csv FILE         also write the results to FILE" << endl;
+    cerr << "  --check            compare the pipeline with calculateRR and simulateAging first" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    int numProcs = 1000;
+    int frames = 256;
+    vector<int> quanta = {1, 2, 4, 8, 16, 32, 64};
+    int refsPerTick = 16;
+    string refsFile, csvFile;
+    uint64_t seed = 12345;
+    bool check = false;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--check") {
+            check = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+        string value = argv[++i];
+        if (arg == "--procs") {
+            numProcs = atoi(value.c_str());
+        } else if (arg == "--frames") {
+            frames = atoi(value.c_str());
+        } else if (arg == "--quanta") {
+            quanta = splitInts(value);
+        } else if (arg == "--refs-per-tick") {
+            refsPerTick = atoi(value.c_str());
+        } else if (arg == "--refs") {
+            refsFile = value;
+        } else if (arg == "--seed") {
+            seed = strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--csv") {
+            csvFile = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    bool validQuanta = !quanta.empty();
+    for (int quantum : quanta) {
+        if (quantum < 1) validQuanta = false;
+    }
+    if (numProcs < 1 || frames < 1 || refsPerTick < 0 || !validQuanta) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    vector<int> recorded;
+    if (!refsFile.empty()) {
+        ifstream inputFile(refsFile);
+        int ref;
+        while (inputFile >> ref) {
+            recorded.push_back(ref);
+        }
+        if (recorded.empty()) {
+            cout << "Error: no references in " << refsFile << endl;
+            return 1;
+        }
+    }
+    const vector<int>* recordedRefs = recorded.empty() ? nullptr : &recorded;
+
+    if (check && !runChecks(recordedRefs, seed)) {
+        return 1;
+    }
+
+    ofstream csv;
+    if (!csvFile.empty()) {
+        csv.open(csvFile);
+        if (!csv.is_open()) {
+            cout << "Error: could not write " << csvFile << endl;
+            return 1;
+        }
+        csv << "Quantum,Processes,Frames,Dispatches,Avg_Wait,References,Faults,Faults_Per_1000\n";
+    }
+
+    vector<Process> procs = makeProcesses(numProcs, seed);
+    cout << numProcs << " processes, " << frames << " shared frames, " << refsPerTick << " references per tick, "
+         << (recordedRefs ? refsFile + " replayed" : string("synthetic references")) << endl;
+    cout << "quantum  dispatches    avg_wait    references      faults  faults/1000   seconds" << endl;
+
+    for (int quantum : quanta) {
+        RunResult r = runPipeline(procs, quantum, frames, refsPerTick, recordedRefs, seed);
+        double faultsPer1000 = r.references ? (double)r.faults / r.references * 1000.0 : 0;
+
+        printf("%7d %11ld %11.1f %13ld %11ld %12.2f %9.2f\n", quantum, r.schedule.dispatches,
+               r.schedule.avgWait, r.references, r.faults, faultsPer1000, r.seconds);
+        fflush(stdout);
+        if (csv.is_open()) {
+            csv << quantum << "," << numProcs << "," << frames << "," << r.schedule.dispatches << ","
+                << r.schedule.avgWait << "," << r.references << "," << r.faults << "," << faultsPer1000 << "\n";
+        }
+    }
+    return 0;
+}
@@ -1,52 +1,451 @@
 #include <iostream>
 #include <vector>
+#include <string>
+#include <memory>
+#include <unordered_map>
 #include <thread>
 #include <cstring>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
 #include <mutex>
+#include <functional>
+#include <chrono>
+#include "server_metrics.h"
+#include "server_history.h"
+#include "server_uring.h"
 
 using namespace std;
 
 #define PORT 8080
 #define BUFFER_SIZE 1024
+#define MAX_LINE 4096
+#define ROOM_SHARDS 16
+#define DEFAULT_ROOM "general"
 
-vector<int> clients;
-mutex clients_mutex; 
+// Every line and room name has to fit a history slot whole, otherwise
+// /resume would hand back something other than what was sent
+static_assert(MAX_LINE <= HISTORY_TEXT, "history slots are shorter than MAX_LINE");
+static_assert(REPLAY_MAX_BYTES + HISTORY_LINE < URING_MAX_OUTBOX, "a whole /resume reply must fit the outbox");
 
-void broadcast(string message, int sender_fd) {
-    lock_guard<mutex> lock(clients_mutex);
-    for (int client_fd : clients) {
-        if (client_fd != sender_fd) {
-            send(client_fd, message.c_str(), message.size(), 0);
+// Protocol: one message per line. Lines starting with '/' are commands:
+//   /join <room>       join a room and send your messages there
+//   /subscribe <room>  receive a room's messages, keep sending where you were
+//   /leave <room>      stop receiving a room
+//   /rooms             list the rooms you are in
+//   /resume <seq>      send what came after <seq> from your rooms again,
+//                      a long gap in pieces ("more after @<seq>")
+// Everyone starts in DEFAULT_ROOM. Chat lines are sent as
+// "@<seq> [room] text", so a client that reconnects knows where it left.
+
+struct Client {
+    int fd;
+    mutex sendLock;          // a line from two rooms must not interleave
+    atomic<bool> open{true};
+    UringConn* conn = nullptr;   // set when the io_uring backend runs it
+
+    explicit Client(int fd) : fd(fd) {}
+
+    // Closed only when the last membership snapshot lets go, so a
+    // broadcast that still holds this client never writes to a reused fd
+    ~Client() { close(fd); }
+};
+
+UringServer uring;
+
+void deliver(Client& client, const string& data) {
+    if (!client.open.load(memory_order_relaxed)) return;
+    ThreadMetrics& m = metrics();
+
+    // One event loop thread does everything, the send joins its batch
+    if (client.conn) {
+        uring.send(client.conn, data);
+        bump(m.messagesOut);
+        bump(m.bytesOut, data.size());
+        return;
+    }
+
+    lock_guard<mutex> lock(client.sendLock);
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t sent = send(client.fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            client.open = false;
+            return;
+        }
+        done += sent;
+    }
+    bump(m.messagesOut);
+    bump(m.bytesOut, done);
+}
+
+// Membership is an immutable vector swapped in whole (RCU style). A
+// broadcast walks the current list without any lock, join/leave copy
+// it, change the copy and publish it.
+typedef vector<shared_ptr<Client>> MemberList;
+
+// Hazard pointers keep a list alive while a broadcast walks it. Each
+// thread owns one slot and publishes the list it is walking there; a
+// replaced list is freed once no slot points at it. Readers only write
+// their own slot, so broadcasts never contend, not even in one room.
+struct alignas(64) HazardSlot {
+    atomic<const void*> ptr{nullptr};
+    atomic<bool> taken{false};
+    HazardSlot* next = nullptr;
+};
+
+atomic<HazardSlot*> hazardSlots{nullptr};
+
+// Threads come and go with connections, a slot is reused once its
+// thread ends. Slots are never freed, there is one per live thread.
+struct HazardOwner {
+    HazardSlot* slot;
+
+    HazardOwner() {
+        for (slot = hazardSlots.load(); slot; slot = slot->next) {
+            bool expected = false;
+            if (slot->taken.compare_exchange_strong(expected, true)) return;
+        }
+        slot = new HazardSlot;
+        slot->taken = true;
+        slot->next = hazardSlots.load();
+        while (!hazardSlots.compare_exchange_weak(slot->next, slot)) {}
+    }
+
+    ~HazardOwner() {
+        slot->ptr = nullptr;
+        slot->taken = false;
+    }
+};
+
+HazardSlot& hazardSlot() {
+    thread_local HazardOwner owner;
+    return *owner.slot;
+}
+
+bool hazardous(const void* p) {
+    for (HazardSlot* slot = hazardSlots.load(); slot; slot = slot->next) {
+        if (slot->ptr.load() == p) return true;
+    }
+    return false;
+}
+
+struct Room {
+    string name;
+    mutex writeLock;                          // serializes join/leave only
+    atomic<const MemberList*> members{new MemberList};
+    vector<const MemberList*> retired;        // replaced, still being walked
+    atomic<bool> hasRetired{false};
+
+    Room() = default;
+    Room(const Room&) = delete;
+
+    // Nobody walks a room nobody holds any more
+    ~Room() {
+        delete members.load();
+        for (const MemberList* list : retired) delete list;
+    }
+
+    // Callers hold writeLock
+    void publish(MemberList* updated) {
+        retired.push_back(members.exchange(updated));
+        reclaim();
+    }
+
+    void reclaim() {
+        retired.erase(remove_if(retired.begin(), retired.end(), [](const MemberList* list) {
+            if (hazardous(list)) return false;
+            delete list;
+            return true;
+        }), retired.end());
+        hasRetired = !retired.empty();
+    }
+};
+
+// Rooms are spread over shards by name hash, so joins and leaves in
+// different rooms rarely share a lock, and broadcasts take none at all:
+// a connection keeps a pointer to every room it is in.
+struct RoomShard {
+    mutex lock;
+    unordered_map<string, shared_ptr<Room>> rooms;
+};
+
+RoomShard shards[ROOM_SHARDS];
+History history;
+
+RoomShard& shardFor(const string& name) {
+    return shards[hash<string>()(name) % ROOM_SHARDS];
+}
+
+shared_ptr<Room> joinRoom(const string& name, const shared_ptr<Client>& client) {
+    RoomShard& shard = shardFor(name);
+    lock_guard<mutex> shardLock(shard.lock);
+
+    shared_ptr<Room>& room = shard.rooms[name];
+    if (!room) {
+        room = make_shared<Room>();
+        room->name = name;
+    }
+
+    lock_guard<mutex> roomLock(room->writeLock);
+    MemberList* updated = new MemberList(*room->members.load());
+    updated->push_back(client);
+    room->publish(updated);
+    return room;
+}
+
+void leaveRoom(const shared_ptr<Room>& room, const shared_ptr<Client>& client) {
+    RoomShard& shard = shardFor(room->name);
+    lock_guard<mutex> shardLock(shard.lock);
+    lock_guard<mutex> roomLock(room->writeLock);
+
+    MemberList* updated = new MemberList(*room->members.load());
+    updated->erase(remove(updated->begin(), updated->end(), client), updated->end());
+    room->publish(updated);
+
+    // Nobody can be about to join it: joins hold the shard lock too
+    if (updated->empty()) {
+        shard.rooms.erase(room->name);
+    }
+}
+
+void broadcast(Room& room, const string& message, const Client* sender) {
+    // Publish the list, then check it is still current: a writer that
+    // replaced it earlier may not have seen the slot and could free it
+    HazardSlot& hazard = hazardSlot();
+    const MemberList* members;
+    do {
+        members = room.members.load();
+        hazard.ptr = members;
+    } while (room.members.load() != members);
+
+    for (const shared_ptr<Client>& member : *members) {
+        if (member.get() != sender) {
+            deliver(*member, message);
+        }
+    }
+    hazard.ptr = nullptr;
+
+    // A list replaced while it was walked holds its clients (and their
+    // fds) until freed; do it now unless a writer is busy anyway
+    if (room.hasRetired.load(memory_order_relaxed) && room.writeLock.try_lock()) {
+        room.reclaim();
+        room.writeLock.unlock();
+    }
+}
+
+// Per-connection state, only touched by the connection's own thread
+// (or the event loop thread with io_uring)
+struct Session {
+    shared_ptr<Client> client;
+    string pending;                   // received after the last full line
+    vector<shared_ptr<Room>> rooms;
+    shared_ptr<Room> current;         // where plain messages go
+
+    shared_ptr<Room> find(const string& name) {
+        for (auto& room : rooms) {
+            if (room->name == name) return room;
+        }
+        return nullptr;
+    }
+};
+
+void handleCommand(Session& session, const string& line) {
+    size_t space = line.find(' ');
+    string command = line.substr(0, space);
+    string name = space == string::npos ? "" : line.substr(space + 1);
+    name.erase(0, name.find_first_not_of(" \t"));
+    name.erase(name.find_last_not_of(" \t\r") + 1);
+
+    if (command == "/resume") {
+        // What was missed goes out in one write, notice first. A long
+        // gap comes in pieces, the notice says where to resume next.
+        uint64_t after = strtoull(name.c_str(), nullptr, 10);
+        uint64_t cut;
+        string missed;
+        size_t count = history.replay(after, [&](const string& room) {
+            return session.find(room) != nullptr;
+        }, missed, cut);
+        string notice = "* resumed after @" + to_string(after) + ", " + to_string(count) + " missed message(s)";
+        if (cut != 0) notice += ", more after @" + to_string(cut);
+        deliver(*session.client, notice + "\n" + missed);
+        return;
+    }
+
+    if (command == "/rooms") {
+        string reply = "* rooms:";
+        for (auto& room : session.rooms) {
+            reply += " " + room->name + (room == session.current ? "(*)" : "");
+        }
+        deliver(*session.client, reply + "\n");
+        return;
+    }
+
+    if ((command == "/join" || command == "/subscribe" || command == "/leave") && name.empty()) {
+        deliver(*session.client, "* usage: " + command + " <room>\n");
+        return;
+    }
+
+    if ((command == "/join" || command == "/subscribe") && name.size() >= HISTORY_ROOM) {
+        deliver(*session.client, "* room names are limited to " + to_string(HISTORY_ROOM - 1) + " bytes\n");
+        return;
+    }
+
+    if (command == "/join" || command == "/subscribe") {
+        shared_ptr<Room> room = session.find(name);
+        if (!room) {
+            room = joinRoom(name, session.client);
+            session.rooms.push_back(room);
         }
+        if (command == "/join") session.current = room;
+        deliver(*session.client, string(command == "/join" ? "* joined " : "* subscribed to ") + name + "\n");
+    } else if (command == "/leave") {
+        shared_ptr<Room> room = session.find(name);
+        if (!room) {
+            deliver(*session.client, "* not in " + name + "\n");
+            return;
+        }
+        leaveRoom(room, session.client);
+        session.rooms.erase(find(session.rooms.begin(), session.rooms.end(), room));
+        if (session.current == room) session.current = nullptr;
+        deliver(*session.client, "* left " + name + "\n");
+    } else {
+        deliver(*session.client, "* unknown command " + command + "\n");
+    }
+}
+
+void handleLine(Session& session, const string& line) {
+    if (line.empty()) return;
+    if (line[0] == '/') {
+        handleCommand(session, line);
+        return;
+    }
+    if (!session.current) {
+        deliver(*session.client, "* you are not in a room, use /join <room>\n");
+        return;
+    }
+
+    // One read can carry a longer line than MAX_LINE, send what fits
+    string text = line.size() > MAX_LINE ? line.substr(0, MAX_LINE) : line;
+
+    auto received_at = chrono::steady_clock::now();
+    logger().log("Message received: [", session.current->name, "] ", text);
+    string wire = history.append(session.current->name, text);
+    broadcast(*session.current, wire, session.client.get());
+    recordFanout(chrono::steady_clock::now() - received_at);
+}
+
+void openSession(Session& session, int client_fd, UringConn* conn = nullptr) {
+    registry().connectedClients++;
+    registry().connectionsTotal++;
+    logger().log("New client joined the chat!");
+
+    session.client = make_shared<Client>(client_fd);
+    session.client->conn = conn;
+    session.current = joinRoom(DEFAULT_ROOM, session.client);
+    session.rooms.push_back(session.current);
+    deliver(*session.client, "* connected at @" + to_string(history.lastSeq()) + "\n");
+}
+
+void receive(Session& session, const char* data, size_t len) {
+    ThreadMetrics& m = metrics();
+    bump(m.bytesIn, len);
+    session.pending.append(data, len);
+
+    size_t start = 0, newline;
+    while ((newline = session.pending.find('\n', start)) != string::npos) {
+        bump(m.messagesIn);
+        handleLine(session, session.pending.substr(start, newline - start));
+        start = newline + 1;
+    }
+    session.pending.erase(0, start);
+
+    // Nobody types a line this long, cut it rather than buffer forever
+    if (session.pending.size() > MAX_LINE) {
+        bump(m.messagesIn);
+        handleLine(session, session.pending);
+        session.pending.clear();
+    }
+}
+
+void closeSession(Session& session) {
+    logger().log("A client has disconnected.");
+    registry().connectedClients--;
+    session.client->open = false;
+    shutdown(session.client->fd, SHUT_RDWR);
+    for (auto& room : session.rooms) {
+        leaveRoom(room, session.client);
     }
 }
 
 void handle_client(int client_fd) {
     char buffer[BUFFER_SIZE];
+    Session session;
+    openSession(session, client_fd);
+
     while (true) {
-        memset(buffer, 0, BUFFER_SIZE);
         int bytes_received = recv(client_fd, buffer, BUFFER_SIZE, 0);
-        
+
         if (bytes_received <= 0) {
-            cout << "A client has disconnected." << endl;
-            lock_guard<mutex> lock(clients_mutex);
-            clients.erase(remove(clients.begin(), clients.end(), client_fd), clients.end());
-            close(client_fd);
             break;
         }
-        
-        cout << "Message received: " << buffer << endl;
-        broadcast(string(buffer), client_fd);
+        receive(session, buffer, bytes_received);
+    }
+    closeSession(session);
+}
+
+// Runs the server on io_uring until the process ends. Returns false right
+// away if io_uring cannot be used here.
+bool runUring(int server_fd) {
+    string error;
+    if (!uring.init(error)) {
+        cout << "io_uring is not available (" << error << "), using a thread per client." << endl;
+        return false;
     }
+
+    uring.onOpen = [](UringConn* conn) {
+        Session* session = new Session;
+        conn->user = session;
+        openSession(*session, conn->fd, conn);
+    };
+    uring.onData = [](UringConn* conn, const char* data, size_t len) {
+        receive(*(Session*)conn->user, data, len);
+    };
+    uring.onClose = [](UringConn* conn) {
+        Session* session = (Session*)conn->user;
+        closeSession(*session);
+        session->client->conn = nullptr;
+        delete session;               // the Client closes the fd
+    };
+
+    cout << "Using the io_uring backend." << endl;
+    uring.run(server_fd);
+    return true;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Usage: server [--history-log FILE] [--backend threads|uring]
+    string backend = "threads";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--history-log") == 0 && i + 1 < argc) {
+            if (!history.openLog(argv[++i])) {
+                perror("Could not open the history log");
+                return 1;
+            }
+            cout << "History log: " << argv[i] << ", continuing at @" << history.lastSeq() << endl;
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "threads") == 0 || strcmp(argv[i + 1], "uring") == 0)) {
+            backend = argv[++i];
+        } else {
+            cout << "Usage: " << argv[0] << " [--history-log FILE] [--backend threads|uring]" << endl;
+            return 1;
+        }
+    }
+
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    
+
     int opt = 1;
     setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
@@ -59,16 +458,21 @@ int main() {
     listen(server_fd, 10);
 
     cout << "Server is running on port " << PORT << ". Waiting for connections..." << endl;
+    if (startAdminServer()) {
+        cout << "Metrics at http://127.0.0.1:" << ADMIN_PORT << "/metrics" << endl;
+    } else {
+        cout << "Could not open the metrics port " << ADMIN_PORT << ", continuing without it." << endl;
+    }
+
+    if (backend == "uring") {
+        runUring(server_fd);
+    }
 
     while (true) {
         int client_fd = accept(server_fd, nullptr, nullptr);
-        {
-            lock_guard<mutex> lock(clients_mutex);
-            clients.push_back(client_fd);
-        }
-        cout << "New client joined the chat!" << endl;
+        if (client_fd < 0) continue;
         thread(handle_client, client_fd).detach();
     }
 
     return 0;
-}
\ No newline at end of file
+}
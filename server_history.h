@@ -0,0 +1,295 @@
+#ifndef SERVER_HISTORY_H
+#define SERVER_HISTORY_H
+#include <atomic>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Message history for catch-up after a reconnect.
+//
+// Every chat line gets a global sequence number and is stored, already
+// formatted for the wire, in a fixed ring of HISTORY_SLOTS slots. Memory
+// use never grows. Appends take no lock: the sequence number picks the
+// slot, and each slot is a small seqlock. A reader copies the slot and
+// checks that its sequence number did not change meanwhile.
+//
+// Optionally every line is also appended to an mmap'ed log file, which
+// reaches further back than the ring and survives restarts.
+
+#define HISTORY_SLOTS 4096
+#define HISTORY_TEXT 4096                   // longest chat line the server passes on
+#define HISTORY_LINE (HISTORY_TEXT + 128)   // plus the "@<seq> [room] " prefix
+#define HISTORY_ROOM 64                     // room names are shorter than this
+
+#define SPILL_LOG_SIZE (1ULL << 30)     // sparse, only written pages use disk
+#define SPILL_CHECKPOINT_SHIFT 10       // one index entry per 1024 messages
+#define SPILL_CHECKPOINTS (1 << 16)
+#define SPILL_REORDER 64                // appends this far apart may land out of order
+
+// One /resume hands back at most this much, the notice says where it
+// stopped and the client asks again from there
+#define REPLAY_MAX_MESSAGES 1000
+#define REPLAY_MAX_BYTES (256 << 10)
+#define REPLAY_MAX_SCANNED 65536        // lines looked at, wanted or not
+
+const uint64_t SLOT_WRITING = UINT64_MAX;
+
+struct HistorySlot {
+    std::atomic<uint64_t> seq{0};
+    uint32_t len = 0;
+    char room[HISTORY_ROOM];
+    char line[HISTORY_LINE];
+};
+
+// On-disk record, followed by the room name and the line, padded to 8
+struct SpillRecord {
+    uint64_t seq;       // written last, 0 while the record is incomplete
+    uint32_t len;
+    uint16_t roomLen;
+    uint16_t unused;
+};
+
+class SpillLog {
+public:
+    bool open(const char* path, uint64_t& maxSeq) {
+        fd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) return false;
+        if (ftruncate(fd, SPILL_LOG_SIZE) != 0) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        void* mapped = mmap(nullptr, SPILL_LOG_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        base = (char*)mapped;
+
+        // Find the end of what earlier runs wrote and rebuild the index
+        maxSeq = 0;
+        uint64_t offset = 0;
+        while (offset + sizeof(SpillRecord) <= SPILL_LOG_SIZE) {
+            SpillRecord* r = (SpillRecord*)(base + offset);
+            if (r->seq == 0 || !fits(offset, r->roomLen, r->len, SPILL_LOG_SIZE)) break;   // end, or cut off by a crash
+            if (r->seq > maxSeq) maxSeq = r->seq;
+            markCheckpoint(r->seq, offset);
+            offset += recordSize(r->roomLen, r->len);
+        }
+        tail = offset;
+        return true;
+    }
+
+    bool enabled() const { return base != nullptr; }
+
+    void append(uint64_t seq, const char* room, uint16_t roomLen, const char* line, uint32_t len) {
+        uint64_t size = recordSize(roomLen, len);
+        uint64_t offset = tail.fetch_add(size, std::memory_order_relaxed);
+        if (offset + size > SPILL_LOG_SIZE) {
+            if (!full.exchange(true)) {
+                fprintf(stderr, "History log is full, only the in-memory ring is kept from now on.\n");
+            }
+            return;
+        }
+
+        SpillRecord* r = (SpillRecord*)(base + offset);
+        r->len = len;
+        r->roomLen = roomLen;
+        memcpy(base + offset + sizeof(SpillRecord), room, roomLen);
+        memcpy(base + offset + sizeof(SpillRecord) + roomLen, line, len);
+        __atomic_store_n(&r->seq, seq, __ATOMIC_RELEASE);
+        markCheckpoint(seq, offset);
+    }
+
+    // Calls visit(seq, room, line) for every complete record with
+    // seq in [from, to). Appends race a little, so the scan starts one
+    // index block early and goes SPILL_REORDER records past 'to'. A
+    // record's header is only read once its seq shows it is complete;
+    // the scan stops at the first one that is still being written.
+    //
+    // When visit returns false the scan ends early: 'to' drops to just
+    // past that record, only stragglers below it are still visited.
+    // Returns 'to', the first seq the scan did not cover.
+    uint64_t scan(uint64_t from, uint64_t to,
+                  const std::function<bool(uint64_t, const std::string&, const char*, uint32_t)>& visit) const {
+        if (!enabled()) return to;
+
+        uint64_t offset = 0;
+        uint64_t block = from >> SPILL_CHECKPOINT_SHIFT;
+        if (block > 0) block--;
+        if (block < SPILL_CHECKPOINTS) {
+            uint64_t mark = checkpoints[block].load(std::memory_order_acquire);
+            if (mark > 0) offset = mark - 1;
+        }
+
+        uint64_t end = tail.load(std::memory_order_acquire);
+        if (end > SPILL_LOG_SIZE) end = SPILL_LOG_SIZE;
+        int past = 0;
+        while (offset + sizeof(SpillRecord) <= end && past < SPILL_REORDER) {
+            const SpillRecord* r = (const SpillRecord*)(base + offset);
+            uint64_t seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+            if (seq == 0) break;   // reserved but not written yet
+            uint32_t len = r->len;
+            uint16_t roomLen = r->roomLen;
+            if (!fits(offset, roomLen, len, end)) break;
+            if (seq >= to) {
+                past++;
+            } else if (seq >= from) {
+                const char* data = base + offset + sizeof(SpillRecord);
+                if (!visit(seq, std::string(data, roomLen), data + roomLen, len) && seq + 1 < to) {
+                    to = seq + 1;
+                    past = 0;
+                }
+            }
+            offset += recordSize(roomLen, len);
+        }
+        return to;
+    }
+
+private:
+    int fd = -1;
+    char* base = nullptr;
+    std::atomic<uint64_t> tail{0};
+    std::atomic<bool> full{false};
+    std::atomic<uint64_t> checkpoints[SPILL_CHECKPOINTS] = {};   // offset + 1, 0 = unset
+
+    static uint64_t recordSize(uint16_t roomLen, uint32_t len) {
+        return (sizeof(SpillRecord) + roomLen + len + 7) & ~7ULL;
+    }
+
+    static bool fits(uint64_t offset, uint16_t roomLen, uint32_t len, uint64_t end) {
+        return len > 0 && roomLen < HISTORY_ROOM &&
+               offset + recordSize(roomLen, len) <= end;
+    }
+
+    // Remember the lowest offset seen for each block of sequence numbers
+    void markCheckpoint(uint64_t seq, uint64_t offset) {
+        uint64_t block = seq >> SPILL_CHECKPOINT_SHIFT;
+        if (block >= SPILL_CHECKPOINTS) return;
+        uint64_t current = checkpoints[block].load(std::memory_order_relaxed);
+        while ((current == 0 || current > offset + 1) &&
+               !checkpoints[block].compare_exchange_weak(current, offset + 1, std::memory_order_release)) {
+        }
+    }
+};
+
+class History {
+public:
+    bool openLog(const char* path) {
+        uint64_t maxSeq;
+        if (!spill.open(path, maxSeq)) return false;
+        nextSeq = maxSeq + 1;
+        firstRunSeq = maxSeq + 1;
+        return true;
+    }
+
+    // Numbers a chat line and records it. Returns the line as it goes on
+    // the wire: "@<seq> [room] text\n"
+    std::string append(const std::string& room, const std::string& text) {
+        uint64_t seq = nextSeq.fetch_add(1, std::memory_order_relaxed);
+        std::string wire = "@" + std::to_string(seq) + " [" + room + "] " + text + "\n";
+
+        // The server keeps room names and lines within the slot sizes,
+        // this only guards the slot if a caller does not
+        uint32_t len = wire.size() < HISTORY_LINE ? wire.size() : HISTORY_LINE;
+        uint16_t roomLen = room.size() < HISTORY_ROOM ? room.size() : HISTORY_ROOM - 1;
+
+        HistorySlot& slot = slots[seq % HISTORY_SLOTS];
+        slot.seq.store(SLOT_WRITING, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.len = len;
+        memset(slot.room, 0, HISTORY_ROOM);
+        memcpy(slot.room, room.data(), roomLen);
+        memcpy(slot.line, wire.data(), len);
+        slot.line[len - 1] = '\n';
+        slot.seq.store(seq, std::memory_order_release);
+
+        if (spill.enabled()) {
+            spill.append(seq, room.data(), roomLen, wire.data(), wire.size());
+        }
+        return wire;
+    }
+
+    uint64_t lastSeq() const {
+        return nextSeq.load(std::memory_order_relaxed) - 1;
+    }
+
+    // Appends the lines after 'after' from rooms the caller wants to
+    // 'out', oldest first, and returns how many there were. Lines the
+    // ring has already overwritten come from the log if there is one.
+    // Stops once a REPLAY_MAX_* limit is reached and sets 'cut' to the
+    // last seq covered; 'cut' stays 0 when nothing was left out.
+    size_t replay(uint64_t after, const std::function<bool(const std::string&)>& wanted,
+                  std::string& out, uint64_t& cut) const {
+        uint64_t last = lastSeq();
+        cut = 0;
+        if (after >= last) return 0;
+
+        // Lines from before a restart are only in the log
+        uint64_t ringStart = last >= HISTORY_SLOTS ? last - HISTORY_SLOTS + 1 : 1;
+        ringStart = std::max(ringStart, firstRunSeq);
+        size_t count = 0, scanned = 0;
+        size_t outStart = out.size();
+        auto full = [&]() {
+            return count >= REPLAY_MAX_MESSAGES || out.size() - outStart >= REPLAY_MAX_BYTES ||
+                   scanned >= REPLAY_MAX_SCANNED;
+        };
+
+        if (after + 1 < ringStart) {
+            uint64_t stop = spill.scan(after + 1, ringStart, [&](uint64_t, const std::string& room, const char* line, uint32_t len) {
+                scanned++;
+                if (wanted(room)) {
+                    out.append(line, len);
+                    count++;
+                }
+                return !full();
+            });
+            if (stop < ringStart) {
+                cut = stop - 1;
+                return count;
+            }
+        }
+
+        char room[HISTORY_ROOM + 1];
+        char line[HISTORY_LINE];
+        for (uint64_t seq = std::max(after + 1, ringStart); seq <= last; seq++) {
+            if (full()) {
+                cut = seq - 1;
+                break;
+            }
+            scanned++;
+            const HistorySlot& slot = slots[seq % HISTORY_SLOTS];
+            if (slot.seq.load(std::memory_order_acquire) != seq) continue;
+
+            uint32_t len = slot.len;
+            if (len > HISTORY_LINE) continue;
+            memcpy(room, slot.room, HISTORY_ROOM);
+            memcpy(line, slot.line, len);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != seq) continue;   // overwritten while copying
+
+            room[HISTORY_ROOM] = '\0';
+            if (wanted(room)) {
+                out.append(line, len);
+                count++;
+            }
+        }
+        return count;
+    }
+
+private:
+    HistorySlot slots[HISTORY_SLOTS];
+    std::atomic<uint64_t> nextSeq{1};
+    uint64_t firstRunSeq = 1;       // first seq of this run, older ones are in the log only
+    SpillLog spill;
+};
+
+#endif
@@ -0,0 +1,344 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+// Metrics for the chat server.
+//
+// Every thread counts into its own block, the hot path is a plain load and
+// store on memory no other thread writes, with no lock and no shared cache
+// line. A scrape walks all blocks and adds them up. When a thread exits its
+// block is folded into 'retired' so the totals never go backwards.
+
+#define ADMIN_PORT 8081
+#define ADMIN_TIMEOUT_SEC 1
+#define FANOUT_BUCKETS 25   // 1us .. 2^24us (~16s), plus +Inf
+
+#define LOG_QUEUE_SIZE 4096
+#define LOG_RATE 200        // lines per second
+#define LOG_BURST 400
+#define LOG_FLUSH_MS 10
+
+struct alignas(64) ThreadMetrics {
+    std::atomic<uint64_t> messagesIn{0};
+    std::atomic<uint64_t> messagesOut{0};
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> bytesOut{0};
+    std::atomic<uint64_t> fanoutCount{0};
+    std::atomic<uint64_t> fanoutSumNs{0};
+    std::atomic<uint64_t> fanoutBuckets[FANOUT_BUCKETS + 1] = {};
+};
+
+// Only the owning thread writes, so no locked read-modify-write is needed
+inline void bump(std::atomic<uint64_t>& counter, uint64_t v = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+inline void addInto(ThreadMetrics& dst, const ThreadMetrics& src) {
+    bump(dst.messagesIn, src.messagesIn.load(std::memory_order_relaxed));
+    bump(dst.messagesOut, src.messagesOut.load(std::memory_order_relaxed));
+    bump(dst.bytesIn, src.bytesIn.load(std::memory_order_relaxed));
+    bump(dst.bytesOut, src.bytesOut.load(std::memory_order_relaxed));
+    bump(dst.fanoutCount, src.fanoutCount.load(std::memory_order_relaxed));
+    bump(dst.fanoutSumNs, src.fanoutSumNs.load(std::memory_order_relaxed));
+    for (int b = 0; b <= FANOUT_BUCKETS; b++) {
+        bump(dst.fanoutBuckets[b], src.fanoutBuckets[b].load(std::memory_order_relaxed));
+    }
+}
+
+struct MetricsRegistry {
+    std::mutex lock;                      // registration and scrapes only
+    std::vector<ThreadMetrics*> live;
+    ThreadMetrics retired;
+
+    std::atomic<int64_t> connectedClients{0};
+    std::atomic<uint64_t> connectionsTotal{0};
+};
+
+inline MetricsRegistry& registry() {
+    static MetricsRegistry r;
+    return r;
+}
+
+struct ThreadMetricsHandle {
+    ThreadMetrics* block;
+
+    ThreadMetricsHandle() : block(new ThreadMetrics) {
+        std::lock_guard<std::mutex> guard(registry().lock);
+        registry().live.push_back(block);
+    }
+
+    ~ThreadMetricsHandle() {
+        MetricsRegistry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        addInto(r.retired, *block);
+        for (size_t i = 0; i < r.live.size(); i++) {
+            if (r.live[i] == block) {
+                r.live[i] = r.live.back();
+                r.live.pop_back();
+                break;
+            }
+        }
+        delete block;
+    }
+};
+
+// This thread's counters, registered on first use
+inline ThreadMetrics& metrics() {
+    static thread_local ThreadMetricsHandle handle;
+    return *handle.block;
+}
+
+inline void recordFanout(std::chrono::steady_clock::duration elapsed) {
+    ThreadMetrics& m = metrics();
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    uint64_t us = ns / 1000;
+    int bucket = 0;
+    while (bucket < FANOUT_BUCKETS && us >= (1ULL << bucket)) bucket++;
+    bump(m.fanoutBuckets[bucket]);
+    bump(m.fanoutCount);
+    bump(m.fanoutSumNs, ns);
+}
+
+// ---------------------------------------------------------------------
+// Asynchronous, rate-limited logger. The rate limit is checked before the
+// line is even formatted, and an admitted line goes into a bounded
+// lock-free ring (one sequence number per slot), so callers never take a
+// lock or make a system call. Past the rate limit the check is a single
+// read of a word that is written at most LOG_RATE times a second. A
+// background thread drains the ring every LOG_FLUSH_MS and writes the
+// batch with one flush, so a slow terminal never stalls message handling.
+// ---------------------------------------------------------------------
+struct LogSlot {
+    std::atomic<uint64_t> seq;
+    std::string line;
+};
+
+class AsyncLogger {
+public:
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+
+    AsyncLogger() {
+        for (uint64_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+        std::thread(&AsyncLogger::run, this).detach();
+    }
+
+    // log("Message received: [", room, "] ", text) - the parts are only
+    // joined when the line is going to be written
+    template <class... Parts>
+    void log(const Parts&... parts) {
+        if (!admit()) {
+            drop();
+            return;
+        }
+        std::string line;
+        (line.append(parts), ...);
+        if (!push(std::move(line))) drop();
+    }
+
+    uint64_t depth() const {
+        return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed);
+    }
+
+private:
+    LogSlot slots[LOG_QUEUE_SIZE];
+    alignas(64) std::atomic<uint64_t> tail{0};           // next slot producers claim
+    alignas(64) std::atomic<uint64_t> head{0};           // next slot the writer reads
+    alignas(64) std::atomic<int64_t> nextAllowed{0};     // token bucket as a theoretical arrival time
+    std::atomic<uint64_t> suppressed{0};
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Token bucket kept as the time the bucket would be empty (GCRA):
+    // a line is admitted unless that lies more than LOG_BURST lines ahead
+    bool admit() {
+        const int64_t interval = 1000000000LL / LOG_RATE;
+        int64_t now = nowNs();
+        int64_t current = nextAllowed.load(std::memory_order_relaxed);
+        while (true) {
+            int64_t next = std::max(current, now) + interval;
+            if (next - now > LOG_BURST * interval) return false;
+            if (nextAllowed.compare_exchange_weak(current, next, std::memory_order_relaxed)) return true;
+        }
+    }
+
+    void drop() {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool push(std::string&& line) {
+        uint64_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            LogSlot& slot = slots[pos % LOG_QUEUE_SIZE];
+            int64_t diff = (int64_t)(slot.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.line = std::move(line);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // full
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void run() {
+        std::string batch;
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(LOG_FLUSH_MS));
+
+            uint64_t count = 0;
+            uint64_t pos = head.load(std::memory_order_relaxed);
+            while (true) {
+                LogSlot& slot = slots[pos % LOG_QUEUE_SIZE];
+                if (slot.seq.load(std::memory_order_acquire) != pos + 1) break;
+                batch += slot.line;
+                batch += '\n';
+                slot.line.clear();
+                slot.seq.store(pos + LOG_QUEUE_SIZE, std::memory_order_release);
+                pos++;
+                count++;
+            }
+            head.store(pos, std::memory_order_relaxed);
+
+            uint64_t skipped = suppressed.exchange(0, std::memory_order_relaxed);
+            if (count == 0 && skipped == 0) continue;
+
+            fwrite(batch.data(), 1, batch.size(), stdout);
+            if (skipped > 0) {
+                fprintf(stdout, "(%llu log lines suppressed)\n", (unsigned long long)skipped);
+            }
+            fflush(stdout);
+            written.fetch_add(count, std::memory_order_relaxed);
+            batch.clear();
+        }
+    }
+};
+
+inline AsyncLogger& logger() {
+    static AsyncLogger* instance = new AsyncLogger;   // never destroyed, its thread is detached
+    return *instance;
+}
+
+// ---------------------------------------------------------------------
+// Prometheus text format, served over HTTP on 127.0.0.1:ADMIN_PORT
+// ---------------------------------------------------------------------
+inline std::string renderMetrics() {
+    ThreadMetrics total;
+    MetricsRegistry& r = registry();
+    {
+        std::lock_guard<std::mutex> guard(r.lock);
+        addInto(total, r.retired);
+        for (ThreadMetrics* block : r.live) {
+            addInto(total, *block);
+        }
+    }
+
+    std::string out;
+    char line[256];
+    auto counter = [&](const char* name, const char* help, uint64_t value) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                 name, help, name, name, (unsigned long long)value);
+        out += line;
+    };
+    auto gauge = [&](const char* name, const char* help, long long value) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s gauge\n%s %lld\n",
+                 name, help, name, name, value);
+        out += line;
+    };
+
+    counter("chat_messages_received_total", "Messages received from clients.", total.messagesIn.load());
+    counter("chat_messages_sent_total", "Messages delivered to clients.", total.messagesOut.load());
+    counter("chat_received_bytes_total", "Bytes received from clients.", total.bytesIn.load());
+    counter("chat_sent_bytes_total", "Bytes sent to clients.", total.bytesOut.load());
+    counter("chat_connections_total", "Connections accepted.", r.connectionsTotal.load());
+    gauge("chat_connected_clients", "Clients currently connected.", r.connectedClients.load());
+    gauge("chat_log_queue_depth", "Log lines waiting for the logger thread.", logger().depth());
+    counter("chat_log_lines_written_total", "Log lines written.", logger().written.load());
+    counter("chat_log_lines_dropped_total", "Log lines dropped by rate limit or full queue.", logger().dropped.load());
+
+    out += "# HELP chat_fanout_seconds Time from receiving a message to handing it to every recipient.\n";
+    out += "# TYPE chat_fanout_seconds histogram\n";
+    uint64_t cumulative = 0;
+    for (int b = 0; b < FANOUT_BUCKETS; b++) {
+        cumulative += total.fanoutBuckets[b].load();
+        snprintf(line, sizeof(line), "chat_fanout_seconds_bucket{le=\"%.9g\"} %llu\n",
+                 (double)(1ULL << b) / 1e6, (unsigned long long)cumulative);
+        out += line;
+    }
+    cumulative += total.fanoutBuckets[FANOUT_BUCKETS].load();
+    snprintf(line, sizeof(line), "chat_fanout_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+    out += line;
+    snprintf(line, sizeof(line), "chat_fanout_seconds_sum %.9f\nchat_fanout_seconds_count %llu\n",
+             total.fanoutSumNs.load() / 1e9, (unsigned long long)total.fanoutCount.load());
+    out += line;
+    return out;
+}
+
+inline void serveMetrics(int admin_fd) {
+    while (true) {
+        int fd = accept(admin_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        // One thread serves everyone, a client that sends nothing or reads
+        // nothing must not hold it up
+        struct timeval timeout = {ADMIN_TIMEOUT_SEC, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        // The request itself does not matter, every path returns the metrics
+        char request[1024];
+        recv(fd, request, sizeof(request), 0);
+
+        std::string body = renderMetrics();
+        std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+        close(fd);
+    }
+}
+
+// Loopback only, the numbers are not meant for the outside world
+inline bool startAdminServer() {
+    int admin_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int opt = 1;
+    setsockopt(admin_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(ADMIN_PORT);
+
+    if (bind(admin_fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(admin_fd, 16) < 0) {
+        close(admin_fd);
+        return false;
+    }
+    std::thread(serveMetrics, admin_fd).detach();
+    return true;
+}
+
+#endif
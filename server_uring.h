@@ -0,0 +1,359 @@
+#ifndef SERVER_URING_H
+#define SERVER_URING_H
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+// io_uring backend for the chat server.
+//
+// One thread runs every connection. A multishot accept hands over new
+// sockets and one multishot recv per connection keeps delivering data into
+// buffers the kernel takes from a shared provided-buffer ring, so neither
+// is resubmitted per message. Sends queued while a batch of completions is
+// handled go out together, so the steady state is one io_uring_enter per
+// batch, however many messages and recipients it holds.
+//
+// Raw system calls, no liburing. init() fails cleanly where the kernel
+// (multishot recv needs 6.0) or a sandbox does not allow it, and the
+// caller falls back to a thread per client.
+
+#define URING_ENTRIES 1024
+#define URING_CQ_ENTRIES 8192
+#define URING_BUFFERS 1024              // power of two
+#define URING_BUFFER_SIZE 4096
+#define URING_BUFFER_GROUP 0
+#define URING_MAX_OUTBOX (1 << 20)      // a reader this far behind is dropped
+
+enum UringOp { OP_ACCEPT = 0, OP_RECV = 1, OP_SEND = 2 };   // low bits of user_data
+
+struct UringConn {
+    int fd;
+    void* user = nullptr;
+    std::string outbox;         // queued, not submitted yet
+    std::string inflight;       // the kernel reads this until the send completes
+    size_t inflightDone = 0;
+    int pending = 0;            // submitted requests not completed yet
+    bool dirty = false;         // on the flush list
+    bool broken = false;        // shut down, waiting for the recv to end
+    bool closed = false;        // recv ended, onClose was called
+};
+
+class UringServer {
+public:
+    // Called on the event loop thread. onClose leaves closing the fd
+    // to its owner; the connection itself is freed once nothing
+    // submitted for it is still in flight.
+    std::function<void(UringConn*)> onOpen;
+    std::function<void(UringConn*, const char*, size_t)> onData;
+    std::function<void(UringConn*)> onClose;
+
+    bool init(std::string& error) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+        params.cq_entries = URING_CQ_ENTRIES;
+        ringFd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+        if (ringFd < 0 && errno == EINVAL) {
+            // Before 6.1: completions are processed eagerly, still works
+            memset(&params, 0, sizeof(params));
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = URING_CQ_ENTRIES;
+            ringFd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+        }
+        if (ringFd < 0) return fail(error, std::string("io_uring_setup: ") + strerror(errno));
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP)) return fail(error, "kernel too old");
+
+        size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        char* ring = (char*)mmap(nullptr, std::max(sqSize, cqSize), PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        sqes = (io_uring_sqe*)mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (ring == MAP_FAILED || sqes == MAP_FAILED) return fail(error, std::string("mmap: ") + strerror(errno));
+
+        sqHead = (unsigned*)(ring + params.sq_off.head);
+        sqTail = (unsigned*)(ring + params.sq_off.tail);
+        sqMask = *(unsigned*)(ring + params.sq_off.ring_mask);
+        sqEntries = params.sq_entries;
+        unsigned* sqArray = (unsigned*)(ring + params.sq_off.array);
+        for (unsigned i = 0; i < sqEntries; i++) {
+            sqArray[i] = i;         // entries are always used in ring order
+        }
+        cqHead = (unsigned*)(ring + params.cq_off.head);
+        cqTail = (unsigned*)(ring + params.cq_off.tail);
+        cqMask = *(unsigned*)(ring + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(ring + params.cq_off.cqes);
+
+        bufRing = (io_uring_buf_ring*)mmap(nullptr, URING_BUFFERS * sizeof(io_uring_buf), PROT_READ | PROT_WRITE,
+                                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (bufRing == MAP_FAILED) return fail(error, std::string("mmap: ") + strerror(errno));
+        buffers.resize((size_t)URING_BUFFERS * URING_BUFFER_SIZE);
+
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (uint64_t)bufRing;
+        reg.ring_entries = URING_BUFFERS;
+        reg.bgid = URING_BUFFER_GROUP;
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            return fail(error, std::string("provided buffer ring: ") + strerror(errno));
+        }
+        for (unsigned bid = 0; bid < URING_BUFFERS; bid++) {
+            recycle(bid);
+        }
+        return selfTest(error);
+    }
+
+    // Queues data for a connection, sent with the rest of the batch
+    void send(UringConn* conn, const std::string& data) {
+        if (conn->closed || conn->broken) return;
+        if (conn->outbox.size() + data.size() > URING_MAX_OUTBOX) {
+            drop(conn);
+            return;
+        }
+        conn->outbox += data;
+        markDirty(conn);
+    }
+
+    void run(int listen_fd) {
+        listenFd = listen_fd;
+        armAccept();
+        while (true) {
+            flush();
+            submit(true);
+            reap([this](const io_uring_cqe* cqe) { complete(cqe); });
+        }
+    }
+
+private:
+    int ringFd = -1;
+    int listenFd = -1;
+
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned sqLocalTail = 0;       // entries filled in
+    unsigned sqSubmitted = 0;       // entries the kernel has taken
+    io_uring_sqe* sqes;
+
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+
+    io_uring_buf_ring* bufRing;
+    std::vector<char> buffers;
+    unsigned short bufTail = 0;
+
+    std::vector<UringConn*> dirty;
+
+    bool fail(std::string& error, const std::string& why) {
+        error = why;
+        if (ringFd >= 0) close(ringFd);
+        ringFd = -1;
+        return false;
+    }
+
+    io_uring_sqe* getSqe() {
+        if (sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+            submit(false);
+        }
+        io_uring_sqe* sqe = &sqes[sqLocalTail & sqMask];
+        sqLocalTail++;
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    int submit(bool wait) {
+        __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+        unsigned count = sqLocalTail - sqSubmitted;
+        if (count == 0 && !wait) return 0;
+        int submitted = syscall(__NR_io_uring_enter, ringFd, count, wait ? 1 : 0,
+                                wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (submitted > 0) sqSubmitted += submitted;
+        return submitted;
+    }
+
+    template <class Visit>
+    void reap(Visit visit) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            visit(&cqes[head & cqMask]);
+            head++;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    // Hands a buffer back to the kernel
+    void recycle(unsigned bid) {
+        // Not bufRing->bufs: compiled as C++ the uapi header puts that 8
+        // bytes too far, the entries start at the beginning of the ring
+        io_uring_buf* buf = (io_uring_buf*)bufRing + (bufTail & (URING_BUFFERS - 1));
+        buf->addr = (uint64_t)(buffers.data() + (size_t)bid * URING_BUFFER_SIZE);
+        buf->len = URING_BUFFER_SIZE;
+        buf->bid = bid;
+        bufTail++;
+        __atomic_store_n(&bufRing->tail, bufTail, __ATOMIC_RELEASE);
+    }
+
+    void armAccept() {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listenFd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = OP_ACCEPT;
+    }
+
+    void armRecv(UringConn* conn) {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = conn->fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUFFER_GROUP;
+        sqe->user_data = (uint64_t)conn | OP_RECV;
+        conn->pending++;
+    }
+
+    void sendRest(UringConn* conn) {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = conn->fd;
+        sqe->addr = (uint64_t)(conn->inflight.data() + conn->inflightDone);
+        sqe->len = conn->inflight.size() - conn->inflightDone;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = (uint64_t)conn | OP_SEND;
+        conn->pending++;
+    }
+
+    void markDirty(UringConn* conn) {
+        if (conn->dirty) return;
+        conn->dirty = true;
+        dirty.push_back(conn);
+    }
+
+    // Everything a connection got since its last send goes out as one send
+    void flush() {
+        for (UringConn* conn : dirty) {
+            conn->dirty = false;
+            if (!conn->closed && !conn->broken && conn->inflight.empty() && !conn->outbox.empty()) {
+                conn->inflight.swap(conn->outbox);
+                conn->inflightDone = 0;
+                sendRest(conn);
+            }
+            release(conn);
+        }
+        dirty.clear();
+    }
+
+    // The recv then ends with 0 and the connection closes the normal way.
+    // Once closed, the fd is gone and may already belong to a new client.
+    void drop(UringConn* conn) {
+        if (conn->closed) return;
+        conn->broken = true;
+        conn->outbox.clear();
+        shutdown(conn->fd, SHUT_RDWR);
+    }
+
+    void release(UringConn* conn) {
+        if (conn->closed && conn->pending == 0 && !conn->dirty) delete conn;
+    }
+
+    void complete(const io_uring_cqe* cqe) {
+        UringOp op = (UringOp)(cqe->user_data & 3);
+        UringConn* conn = (UringConn*)(cqe->user_data & ~3ULL);
+        bool more = cqe->flags & IORING_CQE_F_MORE;
+
+        if (op == OP_ACCEPT) {
+            if (cqe->res >= 0) {
+                UringConn* accepted = new UringConn;
+                accepted->fd = cqe->res;
+                onOpen(accepted);
+                armRecv(accepted);
+            }
+            if (!more) armAccept();
+            return;
+        }
+
+        if (op == OP_RECV) {
+            if (cqe->flags & IORING_CQE_F_BUFFER) {
+                unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                if (cqe->res > 0 && !conn->closed) {
+                    onData(conn, buffers.data() + (size_t)bid * URING_BUFFER_SIZE, cqe->res);
+                }
+                recycle(bid);
+            }
+            if (!more) {
+                conn->pending--;
+                if (cqe->res > 0 || cqe->res == -ENOBUFS) {
+                    armRecv(conn);      // stopped early, e.g. ran out of buffers
+                } else if (!conn->closed) {
+                    conn->closed = true;
+                    onClose(conn);
+                }
+            }
+        } else {
+            conn->pending--;
+            if (cqe->res < 0) {
+                drop(conn);
+            } else {
+                conn->inflightDone += cqe->res;
+                if (conn->inflightDone < conn->inflight.size() && !conn->closed && !conn->broken) {
+                    sendRest(conn);
+                } else {
+                    conn->inflight.clear();
+                    if (!conn->outbox.empty()) markDirty(conn);
+                }
+            }
+        }
+        release(conn);
+    }
+
+    // Older kernels reject or ignore pieces of this only once a request
+    // runs, so try a multishot recv on a socket pair before taking over
+    bool selfTest(std::string& error) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+            return fail(error, std::string("socketpair: ") + strerror(errno));
+        }
+        UringConn probe;
+        probe.fd = pair[0];
+        armRecv(&probe);
+        if (write(pair[1], "x", 1) != 1) {
+            close(pair[0]);
+            close(pair[1]);
+            return fail(error, std::string("write: ") + strerror(errno));
+        }
+        close(pair[1]);
+
+        bool ok = false, done = false;
+        std::string why = "no completion";
+        while (!done) {
+            if (submit(true) < 0 && errno != EINTR) {
+                why = std::string("io_uring_enter: ") + strerror(errno);
+                break;
+            }
+            reap([&](const io_uring_cqe* cqe) {
+                if (cqe->flags & IORING_CQE_F_BUFFER) recycle(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                if (cqe->res == 1 && (cqe->flags & IORING_CQE_F_MORE)) ok = true;
+                if (cqe->res < 0) why = std::string("multishot recv: ") + strerror(-cqe->res);
+                if (!(cqe->flags & IORING_CQE_F_MORE)) done = true;
+            });
+        }
+        close(pair[0]);
+        return ok ? true : fail(error, why);
+    }
+};
+
+#endif
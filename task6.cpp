@@ -1,55 +1,785 @@
 #include <iostream>
-#include <filesystem>
-#include <map>
 #include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <getopt.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <string.h>
 
 
 using namespace std;
 
 
-namespace fs = std::filesystem;
+// Raw record returned by getdents64 (glibc does not export it)
+struct linux_dirent64 {
+    ino64_t        d_ino;
+    off64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
 
-int main() {
-    string path;
-    uintmax_t bin_width;
+// Bin layout. Every scheme maps a file size to an index into flat arrays,
+// so adding a file is two array increments instead of a map lookup.
+enum BinMode { BINS_LINEAR, BINS_LOG2, BINS_HDR };
 
-   
-    cout << "Enter the directory path: ";
-    getline(cin, path);
-    cout << "Enter the bin width: ";
-    cin >> bin_width;
+// Every thread keeps a dense array of this many bins (16 bytes each)
+const size_t MAX_BINS = 1 << 20;
 
-    
-    map<uintmax_t, int> histogram;
+struct BinScheme {
+    BinMode mode;
+    uint64_t width;     // linear: bytes per bin
+    int sub_bits;       // hdr: sub-buckets per power of two = 2^sub_bits
+    size_t count;       // number of bins
 
-    try {
-       
-        for (const auto& entry : fs::recursive_directory_iterator(path)) {
-            
-          
-            if (fs::is_regular_file(entry)) {
-                uintmax_t size = fs::file_size(entry);
-                
-                
-                uintmax_t bin_index = size / bin_width;
-                histogram[bin_index]++;
+    void init() {
+        if (mode == BINS_LINEAR) {
+            // count was set from --max-bins, the last bin takes the overflow
+        } else if (mode == BINS_LOG2) {
+            count = 65;   // size 0, then one bin per power of two
+        } else {
+            count = ((size_t)1 << sub_bits) * (64 - sub_bits + 1);
+        }
+    }
+
+    size_t index(uint64_t size) const {
+        if (mode == BINS_LINEAR) {
+            uint64_t i = size / width;
+            return i < count ? i : count - 1;
+        }
+        if (mode == BINS_LOG2) {
+            return size == 0 ? 0 : 64 - __builtin_clzll(size);
+        }
+        // HDR: exact below 2^sub_bits, then 2^sub_bits linear sub-buckets
+        // inside every power of two (fixed relative error)
+        uint64_t sub_count = (uint64_t)1 << sub_bits;
+        if (size < sub_count) return size;
+        int e = 63 - __builtin_clzll(size);
+        uint64_t sub = (size >> (e - sub_bits)) & (sub_count - 1);
+        return sub_count + (e - sub_bits) * sub_count + sub;
+    }
+
+    uint64_t low(size_t i) const {
+        if (mode == BINS_LINEAR) return i * width;
+        if (mode == BINS_LOG2) return i == 0 ? 0 : (uint64_t)1 << (i - 1);
+        uint64_t sub_count = (uint64_t)1 << sub_bits;
+        if (i < sub_count) return i;
+        size_t j = i - sub_count;
+        int shift = j >> sub_bits;
+        return (sub_count + (j & (sub_count - 1))) << shift;
+    }
+
+    uint64_t high(size_t i) const {
+        if (i == count - 1) return UINT64_MAX;
+        return low(i + 1) - 1;
+    }
+};
+
+struct ExtStats {
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+};
+
+typedef pair<uint64_t, string> SizedFile;
+typedef priority_queue<SizedFile, vector<SizedFile>, greater<SizedFile>> TopHeap;
+
+// What one directory holds itself (its files, not its subdirectories).
+// Stored in the cache so an unchanged directory is never read again.
+struct BinEntry {
+    uint32_t bin;
+    uint64_t files;
+    uint64_t bytes;
+};
+
+struct ExtEntry {
+    string ext;
+    uint64_t files;
+    uint64_t bytes;
+};
+
+struct DirRecord {
+    int64_t mtime_sec = 0;
+    int64_t mtime_nsec = 0;
+    vector<string> subdirs;
+    vector<BinEntry> bins;
+    vector<ExtEntry> exts;
+    vector<SizedFile> largest;   // file names only, at most top_n
+};
+
+// Everything one thread collects, merged after the walk
+struct Stats {
+    vector<uint64_t> counts;
+    vector<uint64_t> bytes;
+    unordered_map<string, ExtStats> extensions;
+    TopHeap largest;    // min-heap holding at most top_n files
+    vector<pair<string, DirRecord>> records;   // for the next cache
+};
+
+BinScheme scheme;
+size_t top_n = 10;
+
+// Incremental mode (--cache)
+bool use_cache = false;
+unordered_map<string, DirRecord> old_cache;   // read-only while walking
+int64_t scan_start;
+atomic<long> dirs_scanned(0);
+atomic<long> dirs_reused(0);
+
+// One queue per thread. The owner pushes/pops at the back (depth first,
+// good locality), idle threads steal from the front of someone else's.
+struct WorkQueue {
+    mutex lock;
+    deque<string> dirs;
+};
+
+vector<WorkQueue>* queues;
+atomic<long> pending(0);   // directories queued or being scanned
+atomic<long> queued(0);    // directories waiting in some queue
+
+// Workers with nothing to steal sleep here instead of spinning
+mutex idle_lock;
+condition_variable work_ready;
+atomic<int> idle(0);
+
+
+void pushDir(int id, string dir) {
+    pending++;
+    {
+        lock_guard<mutex> guard((*queues)[id].lock);
+        (*queues)[id].dirs.push_back(move(dir));
+    }
+    queued++;
+    if (idle.load() > 0) {
+        lock_guard<mutex> guard(idle_lock);
+        work_ready.notify_one();
+    }
+}
+
+bool popDir(int id, string& dir) {
+    int n = queues->size();
+
+    {
+        lock_guard<mutex> guard((*queues)[id].lock);
+        if (!(*queues)[id].dirs.empty()) {
+            dir = move((*queues)[id].dirs.back());
+            (*queues)[id].dirs.pop_back();
+            queued--;
+            return true;
+        }
+    }
+
+    for (int k = 1; k < n; k++) {
+        WorkQueue& victim = (*queues)[(id + k) % n];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.dirs.empty()) {
+            dir = move(victim.dirs.front());
+            victim.dirs.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+string extensionOf(const char* name) {
+    const char* dot = strrchr(name, '.');
+    return (dot != NULL && dot != name) ? string(dot + 1) : string("");
+}
+
+// Only build the full path when the file actually makes the top list
+void addToTop(TopHeap& heap, uint64_t size, const string& prefix, const string& name) {
+    if (top_n == 0) return;
+    if (heap.size() < top_n) {
+        heap.push(SizedFile(size, prefix + name));
+    } else if (size > heap.top().first) {
+        heap.pop();
+        heap.push(SizedFile(size, prefix + name));
+    }
+}
+
+void addFile(Stats& stats, const string& prefix, const char* name, uint64_t size) {
+    size_t bin = scheme.index(size);
+    stats.counts[bin]++;
+    stats.bytes[bin] += size;
+
+    ExtStats& ext = stats.extensions[extensionOf(name)];
+    ext.files++;
+    ext.bytes += size;
+
+    addToTop(stats.largest, size, prefix, name);
+}
+
+// A directory's own totals while it is read, flattened into its record
+// once done. Rotated logs (app.log.1 ... app.log.N) give one directory
+// thousands of extensions, so both are hashed.
+struct DirCounts {
+    unordered_map<uint32_t, ExtStats> bins;
+    unordered_map<string, ExtStats> exts;
+    TopHeap largest;
+};
+
+// Same as addFile, but into a directory's own counts
+void recordFile(DirCounts& counts, const char* name, uint64_t size) {
+    ExtStats& bin = counts.bins[scheme.index(size)];
+    bin.files++;
+    bin.bytes += size;
+
+    ExtStats& ext = counts.exts[extensionOf(name)];
+    ext.files++;
+    ext.bytes += size;
+
+    addToTop(counts.largest, size, "", name);
+}
+
+void flattenCounts(DirCounts& counts, DirRecord& record) {
+    for (const auto& b : counts.bins) {
+        record.bins.push_back({b.first, b.second.files, b.second.bytes});
+    }
+    for (const auto& e : counts.exts) {
+        record.exts.push_back({e.first, e.second.files, e.second.bytes});
+    }
+    while (!counts.largest.empty()) {
+        record.largest.push_back(counts.largest.top());
+        counts.largest.pop();
+    }
+}
+
+void mergeRecord(Stats& stats, const string& prefix, const DirRecord& record) {
+    for (const BinEntry& b : record.bins) {
+        stats.counts[b.bin] += b.files;
+        stats.bytes[b.bin] += b.bytes;
+    }
+    for (const ExtEntry& e : record.exts) {
+        stats.extensions[e.ext].files += e.files;
+        stats.extensions[e.ext].bytes += e.bytes;
+    }
+    for (const SizedFile& f : record.largest) {
+        addToTop(stats.largest, f.first, prefix, f.second);
+    }
+}
+
+// Read one directory in bulk. Sizes come from a single statx() per file,
+// relative to the directory fd, and d_type saves the stat for directories.
+// With a cache, a directory whose mtime is unchanged is not read at all:
+// its own totals and list of subdirectories come from the last run.
+void scanDir(int id, const string& dir, Stats& stats, char* buf, size_t buf_size) {
+    string prefix = dir;
+    if (prefix.empty() || prefix.back() != '/') prefix += '/';
+
+    DirRecord record;
+    DirCounts counts;
+    if (use_cache) {
+        struct statx dst;
+        if (statx(AT_FDCWD, dir.c_str(), AT_STATX_DONT_SYNC, STATX_MTIME, &dst) != 0) {
+            return;
+        }
+
+        auto it = old_cache.find(dir);
+        if (it != old_cache.end() && it->second.mtime_sec == dst.stx_mtime.tv_sec &&
+            it->second.mtime_nsec == dst.stx_mtime.tv_nsec) {
+            dirs_reused++;
+            mergeRecord(stats, prefix, it->second);
+            for (const string& sub : it->second.subdirs) {
+                pushDir(id, prefix + sub);
             }
+            stats.records.push_back(*it);
+            return;
         }
 
-        
-        cout << "\nFile Size Histogram:" << endl;
-        
-        
-        for (auto const& [bin_index, count] : histogram) {
-            uintmax_t low = bin_index * bin_width;
-            uintmax_t high = low + bin_width - 1;
-            
-            cout << "[" << low << " - " << high << " bytes]: " << count << " file(s)" << endl;
+        // A directory changed within the last second could change again
+        // without its mtime moving, so it is never trusted next time.
+        if (dst.stx_mtime.tv_sec >= scan_start - 1) {
+            record.mtime_sec = -1;
+        } else {
+            record.mtime_sec = dst.stx_mtime.tv_sec;
+            record.mtime_nsec = dst.stx_mtime.tv_nsec;
         }
+    }
+
+    int dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) return;
+    dirs_scanned++;
+
+    while (true) {
+        long nread = syscall(SYS_getdents64, dir_fd, buf, buf_size);
+        if (nread <= 0) break;
+
+        for (long pos = 0; pos < nread; ) {
+            linux_dirent64* d = (linux_dirent64*)(buf + pos);
+            pos += d->d_reclen;
+
+            const char* name = d->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            unsigned char type = d->d_type;
+            if (type == DT_DIR) {
+                pushDir(id, prefix + name);
+                if (use_cache) record.subdirs.push_back(name);
+                continue;
+            }
+            if (type != DT_REG && type != DT_LNK && type != DT_UNKNOWN) {
+                continue;
+            }
+
+            // Symlinks are counted by their target like fs::is_regular_file
+            // did, but never descended into.
+            int flags = AT_STATX_DONT_SYNC;
+            if (type != DT_LNK) flags |= AT_SYMLINK_NOFOLLOW;
+
+            struct statx stx;
+            if (statx(dir_fd, name, flags, STATX_TYPE | STATX_SIZE, &stx) != 0) {
+                continue;
+            }
+
+            if (S_ISREG(stx.stx_mode)) {
+                if (use_cache) recordFile(counts, name, stx.stx_size);
+                else addFile(stats, prefix, name, stx.stx_size);
+            } else if (S_ISDIR(stx.stx_mode) && type == DT_UNKNOWN) {
+                pushDir(id, prefix + name);
+                if (use_cache) record.subdirs.push_back(name);
+            }
+        }
+    }
+
+    close(dir_fd);
+
+    if (use_cache) {
+        flattenCounts(counts, record);
+        mergeRecord(stats, prefix, record);
+        stats.records.push_back(make_pair(dir, move(record)));
+    }
+}
+
+void worker(int id, Stats* stats) {
+    const size_t buf_size = 64 * 1024;
+    vector<char> buf(buf_size);
+    string dir;
+
+    while (true) {
+        if (popDir(id, dir)) {
+            scanDir(id, dir, *stats, buf.data(), buf_size);
+            if (--pending == 0) {
+                lock_guard<mutex> guard(idle_lock);
+                work_ready.notify_all();
+            }
+        } else if (pending.load() == 0) {
+            break;
+        } else {
+            // Someone is still scanning and may push more, wait for it
+            unique_lock<mutex> guard(idle_lock);
+            idle++;
+            work_ready.wait(guard, [] { return queued.load() > 0 || pending.load() == 0; });
+            idle--;
+        }
+    }
+}
+
+// Cache file: a header with the bin settings (a cache built with other
+// settings is useless) followed by one record per directory.
+const uint64_t CACHE_MAGIC = 0x3145484354534948ULL;   // "HISTCHE1"
+
+void writeU64(FILE* f, uint64_t v) {
+    fwrite(&v, sizeof(v), 1, f);
+}
+
+void writeStr(FILE* f, const string& s) {
+    writeU64(f, s.size());
+    fwrite(s.data(), 1, s.size(), f);
+}
+
+bool readU64(FILE* f, uint64_t& v) {
+    return fread(&v, sizeof(v), 1, f) == 1;
+}
+
+bool readStr(FILE* f, string& s) {
+    uint64_t len;
+    if (!readU64(f, len) || len > (1 << 20)) return false;
+    s.resize(len);
+    return fread(&s[0], 1, len, f) == len;
+}
 
-    } catch (const fs::filesystem_error& e) {
+bool loadCache(const string& file) {
+    FILE* f = fopen(file.c_str(), "rb");
+    if (f == NULL) return false;
+
+    uint64_t magic, mode, width, sub_bits, count, top;
+    bool ok = readU64(f, magic) && readU64(f, mode) && readU64(f, width) &&
+              readU64(f, sub_bits) && readU64(f, count) && readU64(f, top);
+    if (!ok || magic != CACHE_MAGIC || mode != (uint64_t)scheme.mode || width != scheme.width ||
+        sub_bits != (uint64_t)scheme.sub_bits || count != scheme.count || top != top_n) {
+        fclose(f);
+        return false;
+    }
+
+    uint64_t num_dirs;
+    ok = readU64(f, num_dirs);
+    for (uint64_t d = 0; ok && d < num_dirs; d++) {
+        string path;
+        DirRecord record;
+        uint64_t sec, nsec, n;
+        ok = readStr(f, path) && readU64(f, sec) && readU64(f, nsec);
+        record.mtime_sec = sec;
+        record.mtime_nsec = nsec;
+
+        ok = ok && readU64(f, n);
+        for (uint64_t k = 0; ok && k < n; k++) {
+            string sub;
+            ok = readStr(f, sub);
+            record.subdirs.push_back(sub);
+        }
+
+        ok = ok && readU64(f, n);
+        for (uint64_t k = 0; ok && k < n; k++) {
+            uint64_t bin, files, bytes;
+            ok = readU64(f, bin) && readU64(f, files) && readU64(f, bytes) && bin < scheme.count;
+            record.bins.push_back({(uint32_t)bin, files, bytes});
+        }
+
+        ok = ok && readU64(f, n);
+        for (uint64_t k = 0; ok && k < n; k++) {
+            ExtEntry e;
+            ok = readStr(f, e.ext) && readU64(f, e.files) && readU64(f, e.bytes);
+            record.exts.push_back(e);
+        }
+
+        ok = ok && readU64(f, n);
+        for (uint64_t k = 0; ok && k < n; k++) {
+            SizedFile file;
+            ok = readU64(f, file.first) && readStr(f, file.second);
+            record.largest.push_back(file);
+        }
+
+        if (ok) old_cache[path] = move(record);
+    }
+    fclose(f);
+
+    if (!ok) {
+        // Half a cache is worse than none, start over
+        old_cache.clear();
+        return false;
+    }
+    return true;
+}
+
+// Written next to the old cache and renamed over it, so an interrupted
+// run never leaves a truncated cache behind.
+bool saveCache(const string& file, const vector<Stats>& local) {
+    string tmp = file + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (f == NULL) return false;
+
+    writeU64(f, CACHE_MAGIC);
+    writeU64(f, scheme.mode);
+    writeU64(f, scheme.width);
+    writeU64(f, scheme.sub_bits);
+    writeU64(f, scheme.count);
+    writeU64(f, top_n);
+
+    uint64_t num_dirs = 0;
+    for (const Stats& stats : local) num_dirs += stats.records.size();
+    writeU64(f, num_dirs);
+
+    for (const Stats& stats : local) {
+        for (auto const& [path, record] : stats.records) {
+            writeStr(f, path);
+            writeU64(f, record.mtime_sec);
+            writeU64(f, record.mtime_nsec);
+            writeU64(f, record.subdirs.size());
+            for (const string& sub : record.subdirs) writeStr(f, sub);
+            writeU64(f, record.bins.size());
+            for (const BinEntry& b : record.bins) {
+                writeU64(f, b.bin);
+                writeU64(f, b.files);
+                writeU64(f, b.bytes);
+            }
+            writeU64(f, record.exts.size());
+            for (const ExtEntry& e : record.exts) {
+                writeStr(f, e.ext);
+                writeU64(f, e.files);
+                writeU64(f, e.bytes);
+            }
+            writeU64(f, record.largest.size());
+            for (const SizedFile& file : record.largest) {
+                writeU64(f, file.first);
+                writeStr(f, file.second);
+            }
+        }
+    }
+
+    bool ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), file.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+string jsonEscape(const string& text) {
+    string out;
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c < 0x20) {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "\\u%04x", c);
+            out += hex;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+string csvEscape(const string& text) {
+    if (text.find_first_of(",\"\n") == string::npos) return text;
+    string out = "\"";
+    for (char c : text) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+string highText(size_t i) {
+    uint64_t high = scheme.high(i);
+    return high == UINT64_MAX ? string("inf") : to_string(high);
+}
+
+void printUsage(const char* prog) {
+    cerr << "Usage: " << prog << " [options] <directory>" << endl;
+    cerr << "  -b, --bins MODE     log2 (default), hdr or linear" << endl;
+    cerr << "  -w, --width N       bin width in bytes for linear bins (default 4096)" << endl;
+    cerr << "  -m, --max-bins N    number of linear bins, last one collects the rest (default 1024, at most " << MAX_BINS << ")" << endl;
+    cerr << "  -s, --sub-bits N    hdr sub-buckets per power of two = 2^N (default 3, at most 14)" << endl;
+    cerr << "  -t, --top N         list the N largest files (default 10, 0 = off)" << endl;
+    cerr << "  -f, --format FMT    text (default), csv or json" << endl;
+    cerr << "  -j, --threads N     worker threads (default: one per core)" << endl;
+    cerr << "  -c, --cache FILE    reuse totals of directories whose mtime did not change" << endl;
+    cerr << "                      since the last run with the same FILE and bin settings" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    string format = "text";
+    string cache_file;
+    int num_threads = thread::hardware_concurrency();
+
+    scheme.mode = BINS_LOG2;
+    scheme.width = 4096;
+    scheme.sub_bits = 3;
+    scheme.count = 1024;
+
+    static struct option long_options[] = {
+        {"bins",     required_argument, NULL, 'b'},
+        {"width",    required_argument, NULL, 'w'},
+        {"max-bins", required_argument, NULL, 'm'},
+        {"sub-bits", required_argument, NULL, 's'},
+        {"top",      required_argument, NULL, 't'},
+        {"format",   required_argument, NULL, 'f'},
+        {"threads",  required_argument, NULL, 'j'},
+        {"cache",    required_argument, NULL, 'c'},
+        {"help",     no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:w:m:s:t:f:j:c:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'b':
+            if (strcmp(optarg, "linear") == 0) scheme.mode = BINS_LINEAR;
+            else if (strcmp(optarg, "log2") == 0) scheme.mode = BINS_LOG2;
+            else if (strcmp(optarg, "hdr") == 0) scheme.mode = BINS_HDR;
+            else {
+                cerr << "Error: Unknown bin mode '" << optarg << "'." << endl;
+                return 1;
+            }
+            break;
+        case 'w': scheme.width = strtoull(optarg, NULL, 10); break;
+        case 'm': scheme.count = strtoull(optarg, NULL, 10); break;
+        case 's': scheme.sub_bits = atoi(optarg); break;
+        case 't': top_n = strtoull(optarg, NULL, 10); break;
+        case 'f': format = optarg; break;
+        case 'j': num_threads = atoi(optarg); break;
+        case 'c': cache_file = optarg; break;
+        default:
+            printUsage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    string path = argv[optind];
+
+    if (scheme.width == 0 || scheme.count == 0) {
+        cerr << "Error: The bin width and bin count must be positive." << endl;
+        return 1;
+    }
+    if (scheme.sub_bits < 0 || scheme.sub_bits > 14) {
+        cerr << "Error: --sub-bits must be between 0 and 14." << endl;
+        return 1;
+    }
+    if (format != "text" && format != "csv" && format != "json") {
+        cerr << "Error: Unknown format '" << format << "'." << endl;
+        return 1;
+    }
+    scheme.init();
+    if (scheme.count > MAX_BINS) {
+        cerr << "Error: That makes " << scheme.count << " bins, at most " << MAX_BINS << " are allowed." << endl;
+        return 1;
+    }
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
         cerr << "Error: Could not read the directory." << endl;
+        return 1;
+    }
+
+    if (num_threads < 1) num_threads = 1;
+
+    if (!cache_file.empty()) {
+        use_cache = true;
+        scan_start = time(NULL);
+        loadCache(cache_file);
+    }
+
+    vector<WorkQueue> work(num_threads);
+    queues = &work;
+
+    // Each thread fills its own stats, merged once at the end
+    vector<Stats> local(num_threads);
+    for (auto& stats : local) {
+        stats.counts.assign(scheme.count, 0);
+        stats.bytes.assign(scheme.count, 0);
+    }
+    pushDir(0, path);
+
+    vector<thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+        threads.push_back(thread(worker, i, &local[i]));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (use_cache) {
+        if (!saveCache(cache_file, local)) {
+            cerr << "Warning: Could not write the cache file " << cache_file << "." << endl;
+        }
+        cerr << "Directories: " << dirs_scanned.load() << " scanned, "
+             << dirs_reused.load() << " reused from cache" << endl;
+    }
+
+    Stats total = move(local[0]);
+    for (int i = 1; i < num_threads; i++) {
+        for (size_t b = 0; b < scheme.count; b++) {
+            total.counts[b] += local[i].counts[b];
+            total.bytes[b] += local[i].bytes[b];
+        }
+        for (auto const& [ext, ext_stats] : local[i].extensions) {
+            total.extensions[ext].files += ext_stats.files;
+            total.extensions[ext].bytes += ext_stats.bytes;
+        }
+        while (!local[i].largest.empty()) {
+            total.largest.push(local[i].largest.top());
+            local[i].largest.pop();
+            if (total.largest.size() > top_n) total.largest.pop();
+        }
+    }
+
+    // Largest first for the report
+    vector<SizedFile> largest;
+    while (!total.largest.empty()) {
+        largest.push_back(total.largest.top());
+        total.largest.pop();
+    }
+    reverse(largest.begin(), largest.end());
+
+    vector<pair<string, ExtStats>> extensions(total.extensions.begin(), total.extensions.end());
+    sort(extensions.begin(), extensions.end(), [](const pair<string, ExtStats>& a, const pair<string, ExtStats>& b) {
+        return a.second.bytes != b.second.bytes ? a.second.bytes > b.second.bytes : a.first < b.first;
+    });
+
+    if (format == "csv") {
+        // One table, the first column says which section a row belongs to
+        cout << "section,key,low,high,files,bytes\n";
+        for (size_t b = 0; b < scheme.count; b++) {
+            if (total.counts[b] == 0) continue;
+            cout << "bin,," << scheme.low(b) << "," << highText(b) << ","
+                 << total.counts[b] << "," << total.bytes[b] << "\n";
+        }
+        for (auto const& [ext, ext_stats] : extensions) {
+            cout << "ext," << csvEscape(ext) << ",,," << ext_stats.files << "," << ext_stats.bytes << "\n";
+        }
+        for (auto const& [size, file] : largest) {
+            cout << "top," << csvEscape(file) << ",,,1," << size << "\n";
+        }
+    } else if (format == "json") {
+        cout << "{\n  \"path\": \"" << jsonEscape(path) << "\",\n  \"bins\": [";
+        bool first = true;
+        for (size_t b = 0; b < scheme.count; b++) {
+            if (total.counts[b] == 0) continue;
+            cout << (first ? "\n" : ",\n") << "    {\"low\": " << scheme.low(b) << ", \"high\": ";
+            if (scheme.high(b) == UINT64_MAX) cout << "null";
+            else cout << scheme.high(b);
+            cout << ", \"files\": " << total.counts[b] << ", \"bytes\": " << total.bytes[b] << "}";
+            first = false;
+        }
+        cout << "\n  ],\n  \"extensions\": [";
+        first = true;
+        for (auto const& [ext, ext_stats] : extensions) {
+            cout << (first ? "\n" : ",\n") << "    {\"ext\": \"" << jsonEscape(ext) << "\", \"files\": "
+                 << ext_stats.files << ", \"bytes\": " << ext_stats.bytes << "}";
+            first = false;
+        }
+        cout << "\n  ],\n  \"top\": [";
+        first = true;
+        for (auto const& [size, file] : largest) {
+            cout << (first ? "\n" : ",\n") << "    {\"path\": \"" << jsonEscape(file) << "\", \"bytes\": " << size << "}";
+            first = false;
+        }
+        cout << "\n  ]\n}\n";
+    } else {
+        cout << "File Size Histogram:" << endl;
+        for (size_t b = 0; b < scheme.count; b++) {
+            if (total.counts[b] == 0) continue;
+            cout << "[" << scheme.low(b) << " - " << highText(b) << " bytes]: " << total.counts[b]
+                 << " file(s), " << total.bytes[b] << " bytes" << endl;
+        }
+
+        cout << "\nBy Extension:" << endl;
+        for (auto const& [ext, ext_stats] : extensions) {
+            cout << (ext.empty() ? "(none)" : "." + ext) << ": " << ext_stats.files << " file(s), "
+                 << ext_stats.bytes << " bytes" << endl;
+        }
+
+        if (!largest.empty()) {
+            cout << "\nLargest Files:" << endl;
+            for (auto const& [size, file] : largest) {
+                cout << size << "\t" << file << endl;
+            }
+        }
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "des.h"
+
+// Build: g++ -O2 -march=native bench.cpp -o bench
+// (-march=native or -mavx2 lets the 256-lane engine use AVX2 registers)
+
+using namespace std;
+
+const int MAX_LEN = 9;
+const char saltChars[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// Hashes every password with one engine, 'lanes' at a time
+template <typename V>
+void runBitsliced(const vector<const char*>& passwords, const vector<const char*>& salts,
+                  vector<char[DES_HASH_SIZE]>& out) {
+    const int LANES = sizeof(V) * 8;
+    for (size_t i = 0; i < passwords.size(); i += LANES) {
+        int count = min((size_t)LANES, passwords.size() - i);
+        desCryptBitsliced<V>(&passwords[i], &salts[i], &out[i], count);
+    }
+}
+
+void runScalar(const vector<const char*>& passwords, const vector<const char*>& salts,
+               vector<char[DES_HASH_SIZE]>& out) {
+    for (size_t i = 0; i < passwords.size(); i++) {
+        desCrypt(passwords[i], salts[i], out[i]);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int count = 16384;
+    if (argc > 1) count = atoi(argv[1]);
+    if (count < 1) {
+        cout << "Usage: " << argv[0] << " [number of passwords]" << endl;
+        return 1;
+    }
+
+    // Random printable passwords and salts, fixed seed so runs compare
+    srand(42);
+    vector<char> pwBuffer(count * MAX_LEN);
+    vector<char> saltBuffer(count * 3);
+    vector<const char*> passwords(count), salts(count);
+    for (int i = 0; i < count; i++) {
+        char* pw = &pwBuffer[i * MAX_LEN];
+        int len = 1 + rand() % 8;
+        for (int c = 0; c < len; c++) pw[c] = 33 + rand() % 94;
+        pw[len] = '\0';
+        char* salt = &saltBuffer[i * 3];
+        salt[0] = saltChars[rand() % 64];
+        salt[1] = saltChars[rand() % 64];
+        salt[2] = '\0';
+        passwords[i] = pw;
+        salts[i] = salt;
+    }
+
+    vector<char[DES_HASH_SIZE]> expected(count), out(count);
+
+    struct Engine {
+        const char* name;
+        void (*run)(const vector<const char*>&, const vector<const char*>&, vector<char[DES_HASH_SIZE]>&);
+    };
+    Engine engines[] = {
+        {"scalar",          runScalar},
+        {"bitslice x64",    runBitsliced<des_v64>},
+        {"bitslice x128",   runBitsliced<des_v128>},
+        {"bitslice x256",   runBitsliced<des_v256>},
+    };
+
+    cout << "Hashing " << count << " passwords (crypt(3), 25 x DES)" << endl;
+    cout << left << setw(16) << "Engine" << right << setw(14) << "Seconds" << setw(16) << "Hashes/sec" << endl;
+
+    for (int e = 0; e < 4; e++) {
+        vector<char[DES_HASH_SIZE]>& result = (e == 0) ? expected : out;
+
+        // Warm up tables and caches on a small batch first
+        vector<const char*> warmPw(passwords.begin(), passwords.begin() + min(count, 256));
+        vector<const char*> warmSalt(salts.begin(), salts.begin() + min(count, 256));
+        vector<char[DES_HASH_SIZE]> warmOut(warmPw.size());
+        engines[e].run(warmPw, warmSalt, warmOut);
+
+        auto start = chrono::steady_clock::now();
+        engines[e].run(passwords, salts, result);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << left << setw(16) << engines[e].name << right << fixed << setprecision(3)
+             << setw(14) << seconds << setprecision(0) << setw(16) << count / seconds;
+
+        if (e > 0) {
+            int mismatches = 0;
+            for (int i = 0; i < count; i++) {
+                if (strcmp(expected[i], out[i]) != 0) mismatches++;
+            }
+            if (mismatches > 0) cout << "  (" << mismatches << " hashes differ from scalar!)";
+        }
+        cout << endl;
+    }
+
+    return 0;
+}
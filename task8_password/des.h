@@ -1,14 +1,879 @@
 #ifndef DES_H
 #define DES_H
-#include <string>
+#include <cstdint>
+#include <cstring>
 
+// Traditional crypt(3): the password (first 8 chars, 7 bits each) is the
+// DES key, a block of zeros is encrypted 25 times with an E-box modified
+// by a 12-bit salt, and the result is printed as 2 salt + 11 hash chars.
+//
+// Two engines compute the same hash:
+//   desCrypt            - scalar, table driven, one password per call
+//   desCryptBitsliced<V> - one bit per password in every word of V, so a
+//                          call hashes 64 (uint64_t), 128 (SSE2) or 256
+//                          (AVX2) passwords at once
+// Neither allocates, all work happens in fixed buffers.
 
-std::string encryptDES(std::string data, std::string key) {
-    std::string output = data;
-    for(int i = 0; i < data.length(); i++) {
-        output[i] = data[i] ^ key[i % key.length()];
-        output[i] = (output[i] << 1) | (output[i] >> 7);
+const int DES_HASH_SIZE = 14;   // 13 chars + '\0'
+
+typedef uint64_t des_v64;
+typedef uint64_t des_v128 __attribute__((vector_size(16)));
+typedef uint64_t des_v256 __attribute__((vector_size(32)));
+
+// DES tables, bit numbers are 1-based with bit 1 the most significant
+static constexpr uint8_t DES_FP[64] = {
+    40, 8, 48, 16, 56, 24, 64, 32, 39, 7, 47, 15, 55, 23, 63, 31,
+    38, 6, 46, 14, 54, 22, 62, 30, 37, 5, 45, 13, 53, 21, 61, 29,
+    36, 4, 44, 12, 52, 20, 60, 28, 35, 3, 43, 11, 51, 19, 59, 27,
+    34, 2, 42, 10, 50, 18, 58, 26, 33, 1, 41, 9, 49, 17, 57, 25
+};
+
+static constexpr uint8_t DES_E[48] = {
+    32, 1, 2, 3, 4, 5, 4, 5, 6, 7, 8, 9,
+    8, 9, 10, 11, 12, 13, 12, 13, 14, 15, 16, 17,
+    16, 17, 18, 19, 20, 21, 20, 21, 22, 23, 24, 25,
+    24, 25, 26, 27, 28, 29, 28, 29, 30, 31, 32, 1
+};
+
+static constexpr uint8_t DES_P[32] = {
+    16, 7, 20, 21, 29, 12, 28, 17, 1, 15, 23, 26, 5, 18, 31, 10,
+    2, 8, 24, 14, 32, 27, 3, 9, 19, 13, 30, 6, 22, 11, 4, 25
+};
+
+static constexpr uint8_t DES_PC1[56] = {
+    57, 49, 41, 33, 25, 17, 9, 1, 58, 50, 42, 34, 26, 18,
+    10, 2, 59, 51, 43, 35, 27, 19, 11, 3, 60, 52, 44, 36,
+    63, 55, 47, 39, 31, 23, 15, 7, 62, 54, 46, 38, 30, 22,
+    14, 6, 61, 53, 45, 37, 29, 21, 13, 5, 28, 20, 12, 4
+};
+
+static constexpr uint8_t DES_PC2[48] = {
+    14, 17, 11, 24, 1, 5, 3, 28, 15, 6, 21, 10,
+    23, 19, 12, 4, 26, 8, 16, 7, 27, 20, 13, 2,
+    41, 52, 31, 37, 47, 55, 30, 40, 51, 45, 33, 48,
+    44, 49, 39, 56, 34, 53, 46, 42, 50, 36, 29, 32
+};
+
+static constexpr uint8_t DES_SHIFTS[16] = {1, 1, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 1};
+
+static const uint8_t DES_S[8][64] = {
+    {14, 4, 13, 1, 2, 15, 11, 8, 3, 10, 6, 12, 5, 9, 0, 7,
+     0, 15, 7, 4, 14, 2, 13, 1, 10, 6, 12, 11, 9, 5, 3, 8,
+     4, 1, 14, 8, 13, 6, 2, 11, 15, 12, 9, 7, 3, 10, 5, 0,
+     15, 12, 8, 2, 4, 9, 1, 7, 5, 11, 3, 14, 10, 0, 6, 13},
+    {15, 1, 8, 14, 6, 11, 3, 4, 9, 7, 2, 13, 12, 0, 5, 10,
+     3, 13, 4, 7, 15, 2, 8, 14, 12, 0, 1, 10, 6, 9, 11, 5,
+     0, 14, 7, 11, 10, 4, 13, 1, 5, 8, 12, 6, 9, 3, 2, 15,
+     13, 8, 10, 1, 3, 15, 4, 2, 11, 6, 7, 12, 0, 5, 14, 9},
+    {10, 0, 9, 14, 6, 3, 15, 5, 1, 13, 12, 7, 11, 4, 2, 8,
+     13, 7, 0, 9, 3, 4, 6, 10, 2, 8, 5, 14, 12, 11, 15, 1,
+     13, 6, 4, 9, 8, 15, 3, 0, 11, 1, 2, 12, 5, 10, 14, 7,
+     1, 10, 13, 0, 6, 9, 8, 7, 4, 15, 14, 3, 11, 5, 2, 12},
+    {7, 13, 14, 3, 0, 6, 9, 10, 1, 2, 8, 5, 11, 12, 4, 15,
+     13, 8, 11, 5, 6, 15, 0, 3, 4, 7, 2, 12, 1, 10, 14, 9,
+     10, 6, 9, 0, 12, 11, 7, 13, 15, 1, 3, 14, 5, 2, 8, 4,
+     3, 15, 0, 6, 10, 1, 13, 8, 9, 4, 5, 11, 12, 7, 2, 14},
+    {2, 12, 4, 1, 7, 10, 11, 6, 8, 5, 3, 15, 13, 0, 14, 9,
+     14, 11, 2, 12, 4, 7, 13, 1, 5, 0, 15, 10, 3, 9, 8, 6,
+     4, 2, 1, 11, 10, 13, 7, 8, 15, 9, 12, 5, 6, 3, 0, 14,
+     11, 8, 12, 7, 1, 14, 2, 13, 6, 15, 0, 9, 10, 4, 5, 3},
+    {12, 1, 10, 15, 9, 2, 6, 8, 0, 13, 3, 4, 14, 7, 5, 11,
+     10, 15, 4, 2, 7, 12, 9, 5, 6, 1, 13, 14, 0, 11, 3, 8,
+     9, 14, 15, 5, 2, 8, 12, 3, 7, 0, 4, 10, 1, 13, 11, 6,
+     4, 3, 2, 12, 9, 5, 15, 10, 11, 14, 1, 7, 6, 0, 8, 13},
+    {4, 11, 2, 14, 15, 0, 8, 13, 3, 12, 9, 7, 5, 10, 6, 1,
+     13, 0, 11, 7, 4, 9, 1, 10, 14, 3, 5, 12, 2, 15, 8, 6,
+     1, 4, 11, 13, 12, 3, 7, 14, 10, 15, 6, 8, 0, 5, 9, 2,
+     6, 11, 13, 8, 1, 4, 10, 7, 9, 5, 0, 15, 14, 2, 3, 12},
+    {13, 2, 8, 4, 6, 15, 11, 1, 10, 9, 3, 14, 5, 0, 12, 7,
+     1, 15, 13, 8, 10, 3, 7, 4, 12, 5, 6, 11, 0, 14, 9, 2,
+     7, 11, 4, 1, 9, 12, 14, 2, 0, 6, 10, 13, 15, 3, 5, 8,
+     2, 1, 14, 7, 4, 10, 8, 13, 15, 12, 9, 0, 3, 5, 6, 11}
+};
+
+// Tables derived at compile time, so the bitsliced rounds index with
+// constants only
+struct DesSchedule {
+    uint8_t keyBit[16][48];     // subkey bit -> key bit (0-based)
+    uint8_t pInverse[32];       // S-box output bit -> position after P
+
+    constexpr DesSchedule() : keyBit(), pInverse() {
+        // Key schedule as bit positions, shared by every key
+        uint8_t cd[56] = {};
+        for (int i = 0; i < 56; i++) cd[i] = DES_PC1[i];
+        for (int r = 0; r < 16; r++) {
+            for (int s = 0; s < DES_SHIFTS[r]; s++) {
+                uint8_t c0 = cd[0], d0 = cd[28];
+                for (int i = 0; i < 27; i++) {
+                    cd[i] = cd[i + 1];
+                    cd[28 + i] = cd[29 + i];
+                }
+                cd[27] = c0;
+                cd[55] = d0;
+            }
+            for (int j = 0; j < 48; j++) {
+                keyBit[r][j] = cd[DES_PC2[j] - 1] - 1;
+            }
+        }
+
+        for (int i = 0; i < 32; i++) {
+            pInverse[DES_P[i] - 1] = i;
+        }
+    }
+};
+
+static constexpr DesSchedule DES_SCHEDULE;
+
+// Everything else derived from the tables above, built once on first use
+struct DesTables {
+    uint64_t expand[4][256];    // E-box by input byte, 48-bit result
+    uint32_t sp[8][64];         // S-box followed by P
+
+    DesTables() {
+        for (int b = 0; b < 4; b++) {
+            for (int v = 0; v < 256; v++) {
+                uint64_t e = 0;
+                for (int j = 0; j < 48; j++) {
+                    int bit = DES_E[j] - 1;
+                    if (bit / 8 == b && (v >> (7 - bit % 8)) & 1) {
+                        e |= 1ULL << (47 - j);
+                    }
+                }
+                expand[b][v] = e;
+            }
+        }
+
+        for (int g = 0; g < 8; g++) {
+            for (int x = 0; x < 64; x++) {
+                // Row is bits 1 and 6 of the input, column bits 2-5
+                int s = DES_S[g][((x & 0x20) | ((x & 1) << 4)) | ((x >> 1) & 0xF)];
+                uint32_t out = 0;
+                for (int o = 0; o < 4; o++) {
+                    if ((s >> (3 - o)) & 1) {
+                        out |= 1U << (31 - DES_SCHEDULE.pInverse[4 * g + o]);
+                    }
+                }
+                sp[g][x] = out;
+            }
+        }
+    }
+};
+
+inline const DesTables& desTables() {
+    static const DesTables tables;
+    return tables;
+}
+
+inline int desSaltValue(char c) {
+    if (c > 'Z') c -= 6;
+    if (c > '9') c -= 7;
+    return (c - '.') & 0x3F;
+}
+
+inline char desHashChar(int v) {
+    char c = v + '.';
+    if (c > '9') c += 7;
+    if (c > 'Z') c += 6;
+    return c;
+}
+
+// 64-bit result plus two zero bits, six bits per character
+inline void desEncode(uint64_t block, const char* salt, char* out) {
+    out[0] = salt[0];
+    out[1] = salt[1] ? salt[1] : salt[0];
+    for (int i = 0; i < 10; i++) {
+        out[2 + i] = desHashChar((block >> (58 - 6 * i)) & 0x3F);
+    }
+    out[12] = desHashChar((block & 0xF) << 2);
+    out[13] = '\0';
+}
+
+// Salt bit i swaps E-box outputs i and i + 24
+inline uint64_t desSaltMask(const char* salt) {
+    int bits = desSaltValue(salt[0]) | (desSaltValue(salt[1] ? salt[1] : salt[0]) << 6);
+    uint64_t mask = 0;
+    for (int i = 0; i < 12; i++) {
+        if ((bits >> i) & 1) mask |= 1ULL << (23 - i);
+    }
+    return mask;
+}
+
+inline void desCrypt(const char* password, const char* salt, char* out) {
+    const DesTables& t = desTables();
+
+    uint8_t key[8] = {0};
+    for (int c = 0; c < 8 && password[c]; c++) {
+        key[c] = password[c] << 1;
+    }
+
+    uint64_t subkey[16];
+    for (int r = 0; r < 16; r++) {
+        uint64_t k = 0;
+        for (int j = 0; j < 48; j++) {
+            int bit = DES_SCHEDULE.keyBit[r][j];
+            if ((key[bit / 8] >> (7 - bit % 8)) & 1) k |= 1ULL << (47 - j);
+        }
+        subkey[r] = k;
+    }
+
+    uint64_t saltMask = desSaltMask(salt);
+    uint32_t left = 0, right = 0;
+
+    for (int iter = 0; iter < 25; iter++) {
+        for (int r = 0; r < 16; r++) {
+            uint64_t e = t.expand[0][right >> 24] | t.expand[1][(right >> 16) & 0xFF] |
+                         t.expand[2][(right >> 8) & 0xFF] | t.expand[3][right & 0xFF];
+            uint64_t swap = (e ^ (e >> 24)) & saltMask;
+            e ^= swap | (swap << 24);
+            e ^= subkey[r];
+
+            uint32_t f = t.sp[0][(e >> 42) & 0x3F] | t.sp[1][(e >> 36) & 0x3F] |
+                         t.sp[2][(e >> 30) & 0x3F] | t.sp[3][(e >> 24) & 0x3F] |
+                         t.sp[4][(e >> 18) & 0x3F] | t.sp[5][(e >> 12) & 0x3F] |
+                         t.sp[6][(e >> 6) & 0x3F] | t.sp[7][e & 0x3F];
+
+            uint32_t next = left ^ f;
+            left = right;
+            right = next;
+        }
+        // Output of one encryption (R16 L16) is the next input
+        uint32_t tmp = left;
+        left = right;
+        right = tmp;
+    }
+
+    uint64_t preout = ((uint64_t)left << 32) | right;
+    uint64_t block = 0;
+    for (int i = 0; i < 64; i++) {
+        if ((preout >> (64 - DES_FP[i])) & 1) block |= 1ULL << (63 - i);
     }
-    return output;
+    desEncode(block, salt, out);
 }
-#endif
\ No newline at end of file
+
+// ---------------------------------------------------------------------
+// Bitsliced engine
+// ---------------------------------------------------------------------
+
+#define DES_INLINE inline __attribute__((always_inline))
+
+// The S-boxes as fixed gate circuits instead of table lookups. They were
+// found offline with Kwan's method ("Reducing the Gate Count of Bitslice
+// DES"): split the truth table on an input or on a gate built earlier,
+// treat the other half as don't-care, and reuse every gate already there.
+// a1..a6 are the S-box input bits, a1 the most significant; each output
+// is XORed into its place after P.
+
+// 54 gates
+template <typename V>
+DES_INLINE void desS1(const V& a1, const V& a2, const V& a3, const V& a4, const V& a5, const V& a6,
+                      V& out1, V& out2, V& out3, V& out4) {
+    V x1 = a1 ^ a4;
+    V x2 = ~a6;
+    V x3 = a4 | x2;
+    V x4 = a1 | x3;
+    V x5 = a3 & x4;
+    V x6 = x1 ^ x5;
+    V x7 = a6 ^ x5;
+    V x8 = x2 & ~x6;
+    V x9 = a1 & x8;
+    V x10 = x7 ^ x9;
+    V x11 = a5 & x10;
+    V x12 = x6 ^ x11;
+    V x13 = a3 ^ x8;
+    V x14 = a1 | a4;
+    V x15 = a5 & x14;
+    V x16 = x13 ^ x15;
+    V x17 = x9 | x16;
+    V x18 = x17 & ~a2;
+    V x19 = x12 ^ x18;
+    V x20 = a6 & ~a1;
+    V x21 = a5 ^ x20;
+    V x22 = x21 & ~x12;
+    V x23 = x8 ^ x22;
+    V x24 = x10 & ~a4;
+    V x25 = a2 ^ x24;
+    V x26 = a1 | x12;
+    V x27 = a4 & x26;
+    V x28 = x27 & ~x21;
+    V x29 = x25 ^ x28;
+    V x30 = x29 & ~x18;
+    V x31 = x23 ^ x30;
+    V x32 = x17 & ~x10;
+    V x33 = a6 ^ x1;
+    V x34 = x33 & ~a3;
+    V x35 = x32 ^ x34;
+    V x36 = x1 | x29;
+    V x37 = x36 ^ a5;
+    V x38 = x37 & ~a2;
+    V x39 = x35 ^ x38;
+    V x40 = a6 ^ x19;
+    V x41 = x9 | x40;
+    V x42 = x11 & x41;
+    V x43 = x39 ^ x42;
+    V x44 = a2 & a4;
+    V x45 = a3 ^ x44;
+    V x46 = x40 & ~x43;
+    V x47 = a1 & x46;
+    V x48 = x36 ^ x47;
+    V x49 = x26 & x48;
+    V x50 = x45 ^ x49;
+    V x51 = a1 | x39;
+    V x52 = x29 & x51;
+    V x53 = x23 & x52;
+    V x54 = x50 ^ x53;
+    out1 ^= x31;
+    out2 ^= x19;
+    out3 ^= x43;
+    out4 ^= x54;
+}
+
+// 51 gates
+template <typename V>
+DES_INLINE void desS2(const V& a1, const V& a2, const V& a3, const V& a4, const V& a5, const V& a6,
+                      V& out1, V& out2, V& out3, V& out4) {
+    V x1 = ~a6;
+    V x2 = x1 ^ a3;
+    V x3 = x2 ^ a1;
+    V x4 = x1 | x3;
+    V x5 = a1 & x4;
+    V x6 = a5 & x5;
+    V x7 = x3 ^ x6;
+    V x8 = x1 & ~a3;
+    V x9 = a5 ^ x8;
+    V x10 = a1 | x9;
+    V x11 = a2 & x10;
+    V x12 = x7 ^ x11;
+    V x13 = x6 & ~a6;
+    V x14 = a5 ^ x13;
+    V x15 = a2 | x14;
+    V x16 = x15 & ~a4;
+    V x17 = x12 ^ x16;
+    V x18 = a3 ^ x9;
+    V x19 = x18 ^ a1;
+    V x20 = a5 & x18;
+    V x21 = ~x20;
+    V x22 = a4 & x21;
+    V x23 = x19 ^ x22;
+    V x24 = a6 | x16;
+    V x25 = a3 & a2;
+    V x26 = x24 ^ x25;
+    V x27 = x6 | x26;
+    V x28 = a2 & x27;
+    V x29 = x23 ^ x28;
+    V x30 = ~x17;
+    V x31 = x7 ^ x29;
+    V x32 = a1 & x31;
+    V x33 = x30 ^ x32;
+    V x34 = x33 & ~x14;
+    V x35 = x2 ^ x34;
+    V x36 = a1 ^ x14;
+    V x37 = a4 | x36;
+    V x38 = x1 & ~x17;
+    V x39 = x37 ^ x38;
+    V x40 = x39 & ~a2;
+    V x41 = x35 ^ x40;
+    V x42 = a4 ^ x41;
+    V x43 = x9 | x35;
+    V x44 = x31 & x43;
+    V x45 = x42 ^ x44;
+    V x46 = x33 & ~x39;
+    V x47 = a5 ^ x26;
+    V x48 = x5 & x47;
+    V x49 = x46 ^ x48;
+    V x50 = x19 & x49;
+    V x51 = x45 ^ x50;
+    out1 ^= x17;
+    out2 ^= x29;
+    out3 ^= x51;
+    out4 ^= x41;
+}
+
+// 52 gates
+template <typename V>
+DES_INLINE void desS3(const V& a1, const V& a2, const V& a3, const V& a4, const V& a5, const V& a6,
+                      V& out1, V& out2, V& out3, V& out4) {
+    V x1 = a3 ^ a4;
+    V x2 = x1 ^ a1;
+    V x3 = a1 | a4;
+    V x4 = a6 & x3;
+    V x5 = x2 ^ x4;
+    V x6 = ~x3;
+    V x7 = a3 | x6;
+    V x8 = x7 & ~a2;
+    V x9 = x5 ^ x8;
+    V x10 = a2 | x6;
+    V x11 = a1 | x10;
+    V x12 = a6 | x8;
+    V x13 = a3 & x12;
+    V x14 = x11 ^ x13;
+    V x15 = x4 | x14;
+    V x16 = a5 & x15;
+    V x17 = x9 ^ x16;
+    V x18 = a3 ^ a6;
+    V x19 = x18 ^ a2;
+    V x20 = a6 & ~x9;
+    V x21 = a4 | x20;
+    V x22 = a1 & x21;
+    V x23 = x19 ^ x22;
+    V x24 = a2 & x19;
+    V x25 = x2 ^ x24;
+    V x26 = a1 & x25;
+    V x27 = x1 ^ x26;
+    V x28 = x27 & ~a5;
+    V x29 = x23 ^ x28;
+    V x30 = x12 & x19;
+    V x31 = x9 ^ x21;
+    V x32 = x14 & ~x20;
+    V x33 = a2 & x32;
+    V x34 = x31 ^ x33;
+    V x35 = x3 & x34;
+    V x36 = x30 ^ x35;
+    V x37 = a3 | x17;
+    V x38 = x18 & x21;
+    V x39 = x37 ^ x38;
+    V x40 = a5 & x39;
+    V x41 = x36 ^ x40;
+    V x42 = a4 ^ x18;
+    V x43 = x42 & ~a2;
+    V x44 = x34 & ~x8;
+    V x45 = x36 & x44;
+    V x46 = x43 ^ x45;
+    V x47 = x8 | x39;
+    V x48 = x11 ^ x34;
+    V x49 = x48 & ~x9;
+    V x50 = x47 ^ x49;
+    V x51 = x50 & ~a5;
+    V x52 = x46 ^ x51;
+    out1 ^= x17;
+    out2 ^= x41;
+    out3 ^= x52;
+    out4 ^= x29;
+}
+
+// 51 gates
+template <typename V>
+DES_INLINE void desS4(const V& a1, const V& a2, const V& a3, const V& a4, const V& a5, const V& a6,
+                      V& out1, V& out2, V& out3, V& out4) {
+    V x1 = a4 ^ a5;
+    V x2 = a4 | a5;
+    V x3 = a3 & x1;
+    V x4 = x2 ^ x3;
+    V x5 = a1 & x4;
+    V x6 = x1 ^ x5;
+    V x7 = a3 | x1;
+    V x8 = a1 | x4;
+    V x9 = x8 & ~a4;
+    V x10 = x7 ^ x9;
+    V x11 = x10 & ~a6;
+    V x12 = x6 ^ x11;
+    V x13 = a6 | x4;
+    V x14 = a3 ^ a6;
+    V x15 = a4 & x14;
+    V x16 = x13 ^ x15;
+    V x17 = a6 & ~a5;
+    V x18 = a3 & x17;
+    V x19 = ~x18;
+    V x20 = x19 & ~x8;
+    V x21 = x16 ^ x20;
+    V x22 = x21 & ~a2;
+    V x23 = x12 ^ x22;
+    V x24 = a2 ^ x6;
+    V x25 = a6 & ~x10;
+    V x26 = x24 ^ x25;
+    V x27 = a1 ^ x23;
+    V x28 = x27 ^ x17;
+    V x29 = x22 & x28;
+    V x30 = x26 ^ x29;
+    V x31 = x1 ^ x8;
+    V x32 = a5 ^ x7;
+    V x33 = x32 & ~a6;
+    V x34 = x31 ^ x33;
+    V x35 = a4 ^ x16;
+    V x36 = x35 ^ a3;
+    V x37 = x36 & ~a2;
+    V x38 = x34 ^ x37;
+    V x39 = a2 ^ x36;
+    V x40 = x39 & ~x25;
+    V x41 = x5 & x40;
+    V x42 = x38 ^ x41;
+    V x43 = x14 ^ x42;
+    V x44 = a3 ^ x32;
+    V x45 = x44 & ~x5;
+    V x46 = x43 ^ x45;
+    V x47 = a3 ^ a5;
+    V x48 = x6 & x47;
+    V x49 = ~x48;
+    V x50 = x49 & ~a2;
+    V x51 = x46 ^ x50;
+    out1 ^= x42;
+    out2 ^= x51;
+    out3 ^= x23;
+    out4 ^= x30;
+}
+
+// 55 gates
+template <typename V>
+DES_INLINE void desS5(const V& a1, const V& a2, const V& a3, const V& a4, const V& a5, const V& a6,
+                      V& out1, V& out2, V& out3, V& out4) {
+    V x1 = a3 ^ a6;
+    V x2 = x1 ^ a1;
+    V x3 = a3 | a6;
+    V x4 = a1 & x3;
+    V x5 = x4 & ~a4;
+    V x6 = x2 ^ x5;
+    V x7 = x3 & ~x2;
+    V x8 = a4 | x7;
+    V x9 = x8 & ~a2;
+    V x10 = x6 ^ x9;
+    V x11 = ~x7;
+    V x12 = a4 | x11;
+    V x13 = a3 & x8;
+    V x14 = a4 ^ x13;
+    V x15 = a1 & x14;
+    V x16 = x12 ^ x15;
+    V x17 = a5 & x16;
+    V x18 = x10 ^ x17;
+    V x19 = a2 ^ x1;
+    V x20 = x10 ^ x14;
+    V x21 = x6 & ~x9;
+    V x22 = x21 & ~a3;
+    V x23 = x20 ^ x22;
+    V x24 = x23 & ~x15;
+    V x25 = x19 ^ x24;
+    V x26 = a4 & x21;
+    V x27 = x23 ^ x26;
+    V x28 = x12 ^ x20;
+    V x29 = x18 & x28;
+    V x30 = x27 ^ x29;
+    V x31 = a5 & x30;
+    V x32 = x25 ^ x31;
+    V x33 = x3 | x29;
+    V x34 = x33 & ~a5;
+    V x35 = x8 ^ x34;
+    V x36 = a6 ^ x4;
+    V x37 = x32 & x36;
+    V x38 = x35 ^ x37;
+    V x39 = x13 & ~x17;
+    V x40 = a1 ^ x30;
+    V x41 = x40 & ~x24;
+    V x42 = x39 ^ x41;
+    V x43 = x19 & x42;
+    V x44 = x38 ^ x43;
+    V x45 = x19 ^ x28;
+    V x46 = a5 & x9;
+    V x47 = x45 ^ x46;
+    V x48 = x7 & x40;
+    V x49 = x47 ^ x48;
+    V x50 = x30 & x32;
+    V x51 = x17 ^ x33;
+    V x52 = x51 & ~x36;
+    V x53 = x50 ^ x52;
+    V x54 = x42 & x53;
+    V x55 = x49 ^ x54;
+    out1 ^= x32;
+    out2 ^= x18;
+    out3 ^= x55;
+    out4 ^= x44;
+}
+
+// 53 gates
+template <typename V>
+DES_INLINE void desS6(const V& a1, const V& a2, const V& a3, const V& a4, const V& a5, const V& a6,
+                      V& out1, V& out2, V& out3, V& out4) {
+    V x1 = a1 ^ a4;
+    V x2 = a2 & ~a3;
+    V x3 = x1 ^ x2;
+    V x4 = ~x1;
+    V x5 = a3 | x4;
+    V x6 = x5 & ~a5;
+    V x7 = x3 ^ x6;
+    V x8 = a1 & x7;
+    V x9 = a3 ^ x8;
+    V x10 = a5 | x9;
+    V x11 = ~x10;
+    V x12 = a2 & x9;
+    V x13 = x11 ^ x12;
+    V x14 = x1 & x13;
+    V x15 = x10 ^ x14;
+    V x16 = a6 & x15;
+    V x17 = x7 ^ x16;
+    V x18 = x3 ^ x11;
+    V x19 = x5 & ~a2;
+    V x20 = x18 ^ x19;
+    V x21 = a5 & ~a4;
+    V x22 = x2 ^ x21;
+    V x23 = x9 & x22;
+    V x24 = x20 ^ x23;
+    V x25 = a5 | x17;
+    V x26 = x25 & ~a1;
+    V x27 = x2 ^ x26;
+    V x28 = x1 & x27;
+    V x29 = a1 ^ x28;
+    V x30 = a6 & x29;
+    V x31 = x24 ^ x30;
+    V x32 = a4 ^ x14;
+    V x33 = a3 & x24;
+    V x34 = x32 ^ x33;
+    V x35 = x14 | x27;
+    V x36 = a6 & x35;
+    V x37 = x34 ^ x36;
+    V x38 = x17 ^ x29;
+    V x39 = x9 ^ x36;
+    V x40 = a5 & x39;
+    V x41 = x38 ^ x40;
+    V x42 = x7 & x41;
+    V x43 = x37 ^ x42;
+    V x44 = a2 ^ x43;
+    V x45 = x15 ^ x18;
+    V x46 = x45 & ~x31;
+    V x47 = x44 ^ x46;
+    V x48 = ~x45;
+    V x49 = a4 ^ x12;
+    V x50 = x49 & ~a6;
+    V x51 = x48 ^ x50;
+    V x52 = x51 & ~x17;
+    V x53 = x47 ^ x52;
+    out1 ^= x17;
+    out2 ^= x43;
+    out3 ^= x53;
+    out4 ^= x31;
+}
+
+// 52 gates
+template <typename V>
+DES_INLINE void desS7(const V& a1, const V& a2, const V& a3, const V& a4, const V& a5, const V& a6,
+                      V& out1, V& out2, V& out3, V& out4) {
+    V x1 = a2 ^ a4;
+    V x2 = a3 & ~a6;
+    V x3 = x1 ^ x2;
+    V x4 = a4 | a6;
+    V x5 = a3 ^ a4;
+    V x6 = x5 & ~a2;
+    V x7 = x4 ^ x6;
+    V x8 = a5 & x7;
+    V x9 = x3 ^ x8;
+    V x10 = a5 | x7;
+    V x11 = a2 & ~a3;
+    V x12 = x10 ^ x11;
+    V x13 = x8 | x11;
+    V x14 = a4 & x13;
+    V x15 = x6 ^ x14;
+    V x16 = x15 & ~a6;
+    V x17 = x12 ^ x16;
+    V x18 = x17 & ~a1;
+    V x19 = x9 ^ x18;
+    V x20 = x8 ^ x17;
+    V x21 = a4 & x9;
+    V x22 = a2 & x21;
+    V x23 = a5 ^ x22;
+    V x24 = x23 & ~x16;
+    V x25 = x20 ^ x24;
+    V x26 = x15 & x19;
+    V x27 = a2 & x5;
+    V x28 = x26 ^ x27;
+    V x29 = a6 & x28;
+    V x30 = x10 ^ x29;
+    V x31 = x30 & ~a1;
+    V x32 = x25 ^ x31;
+    V x33 = a2 ^ x31;
+    V x34 = a6 & x33;
+    V x35 = a1 | x7;
+    V x36 = x35 & ~x19;
+    V x37 = x34 ^ x36;
+    V x38 = a4 & x11;
+    V x39 = a1 & x38;
+    V x40 = ~x39;
+    V x41 = x40 & ~x17;
+    V x42 = x37 ^ x41;
+    V x43 = a1 ^ x28;
+    V x44 = x19 ^ x31;
+    V x45 = a6 & x44;
+    V x46 = x17 ^ x45;
+    V x47 = x20 & x46;
+    V x48 = x43 ^ x47;
+    V x49 = x26 & ~x34;
+    V x50 = x20 ^ x49;
+    V x51 = a4 & x50;
+    V x52 = x48 ^ x51;
+    out1 ^= x19;
+    out2 ^= x42;
+    out3 ^= x32;
+    out4 ^= x52;
+}
+
+// 51 gates
+template <typename V>
+DES_INLINE void desS8(const V& a1, const V& a2, const V& a3, const V& a4, const V& a5, const V& a6,
+                      V& out1, V& out2, V& out3, V& out4) {
+    V x1 = a1 ^ a3;
+    V x2 = a2 | a3;
+    V x3 = a6 & x2;
+    V x4 = x1 ^ x3;
+    V x5 = a1 & ~a3;
+    V x6 = a6 | x5;
+    V x7 = a2 | x6;
+    V x8 = x7 & ~a5;
+    V x9 = x4 ^ x8;
+    V x10 = ~a6;
+    V x11 = x10 ^ a5;
+    V x12 = a1 | a5;
+    V x13 = a2 & x12;
+    V x14 = x11 ^ x13;
+    V x15 = a6 & x9;
+    V x16 = x1 & x15;
+    V x17 = x14 ^ x16;
+    V x18 = x17 & ~a4;
+    V x19 = x9 ^ x18;
+    V x20 = x3 ^ x17;
+    V x21 = x1 & ~a5;
+    V x22 = x2 ^ x21;
+    V x23 = x22 & ~x6;
+    V x24 = x20 ^ x23;
+    V x25 = x7 ^ x10;
+    V x26 = a2 & ~x11;
+    V x27 = x26 & ~a1;
+    V x28 = x25 ^ x27;
+    V x29 = a4 & x28;
+    V x30 = x24 ^ x29;
+    V x31 = a6 ^ x22;
+    V x32 = a1 & x31;
+    V x33 = x21 ^ x32;
+    V x34 = a5 | x32;
+    V x35 = x34 & ~a4;
+    V x36 = x33 ^ x35;
+    V x37 = a4 | x9;
+    V x38 = x37 ^ x5;
+    V x39 = x17 | x38;
+    V x40 = a2 & x39;
+    V x41 = x36 ^ x40;
+    V x42 = a2 ^ x19;
+    V x43 = x42 ^ x32;
+    V x44 = x32 ^ x41;
+    V x45 = x8 & x44;
+    V x46 = x43 ^ x45;
+    V x47 = ~x44;
+    V x48 = a2 | x47;
+    V x49 = x22 | x48;
+    V x50 = x49 & ~x30;
+    V x51 = x46 ^ x50;
+    out1 ^= x51;
+    out2 ^= x30;
+    out3 ^= x41;
+    out4 ^= x19;
+}
+
+// dst ^= f(src, key), key being the round's 48 subkey bits in order, so
+// every index is a compile-time constant. Salts differ per lane, so the
+// E-box bits a salt can swap (0-11 with 24-35) go through a mux; the
+// other 24 feed the S-boxes straight from src.
+template <typename V>
+DES_INLINE void desRoundBitsliced(V* dst, const V* src, const V* key, const V* salt) {
+    V lo[12], hi[12];
+#pragma GCC unroll 12
+    for (int i = 0; i < 12; i++) {
+        V a = src[DES_E[i] - 1];
+        V b = src[DES_E[i + 24] - 1];
+        V swap = (a ^ b) & salt[i];
+        lo[i] = a ^ swap;
+        hi[i] = b ^ swap;
+    }
+
+#define DES_LO(j) lo[j]
+#define DES_HI(j) hi[(j) - 24]
+#define DES_SRC(j) src[DES_E[j] - 1]
+#define DES_K(j) key[j]
+#define DES_IN(x, j) x(j) ^ DES_K(j), x(j + 1) ^ DES_K(j + 1), x(j + 2) ^ DES_K(j + 2), \
+                     x(j + 3) ^ DES_K(j + 3), x(j + 4) ^ DES_K(j + 4), x(j + 5) ^ DES_K(j + 5)
+#define DES_OUT(g) dst[DES_SCHEDULE.pInverse[4 * g]], dst[DES_SCHEDULE.pInverse[4 * g + 1]], \
+                   dst[DES_SCHEDULE.pInverse[4 * g + 2]], dst[DES_SCHEDULE.pInverse[4 * g + 3]]
+    desS1(DES_IN(DES_LO, 0), DES_OUT(0));
+    desS2(DES_IN(DES_LO, 6), DES_OUT(1));
+    desS3(DES_IN(DES_SRC, 12), DES_OUT(2));
+    desS4(DES_IN(DES_SRC, 18), DES_OUT(3));
+    desS5(DES_IN(DES_HI, 24), DES_OUT(4));
+    desS6(DES_IN(DES_HI, 30), DES_OUT(5));
+    desS7(DES_IN(DES_SRC, 36), DES_OUT(6));
+    desS8(DES_IN(DES_SRC, 42), DES_OUT(7));
+#undef DES_LO
+#undef DES_HI
+#undef DES_SRC
+#undef DES_K
+#undef DES_IN
+#undef DES_OUT
+}
+
+// Hashes up to sizeof(V) * 8 passwords. salts[i] points to two salt chars,
+// out[i] receives the 13-char hash for passwords[i].
+template <typename V>
+inline void desCryptBitsliced(const char* const* passwords, const char* const* salts,
+                              char (*out)[DES_HASH_SIZE], int count) {
+    const int WORDS = sizeof(V) / sizeof(uint64_t);
+    const int LANES = WORDS * 64;
+    if (count > LANES) count = LANES;
+
+    // Transpose the inputs: vector n holds bit n of every lane
+    uint64_t keyWords[64][WORDS];
+    uint64_t saltWords[12][WORDS];
+    memset(keyWords, 0, sizeof(keyWords));
+    memset(saltWords, 0, sizeof(saltWords));
+
+    for (int l = 0; l < count; l++) {
+        uint64_t laneBit = 1ULL << (l % 64);
+        const char* pw = passwords[l];
+        for (int c = 0; c < 8 && pw[c]; c++) {
+            for (int j = 0; j < 7; j++) {
+                if ((pw[c] >> (6 - j)) & 1) keyWords[8 * c + j][l / 64] |= laneBit;
+            }
+        }
+        const char* s = salts[l];
+        int bits = desSaltValue(s[0]) | (desSaltValue(s[1] ? s[1] : s[0]) << 6);
+        for (int i = 0; i < 12; i++) {
+            if ((bits >> i) & 1) saltWords[i][l / 64] |= laneBit;
+        }
+    }
+
+    V key[64], salt[12];
+    for (int n = 0; n < 64; n++) memcpy(&key[n], keyWords[n], sizeof(V));
+    for (int n = 0; n < 12; n++) memcpy(&salt[n], saltWords[n], sizeof(V));
+
+    V a[32], b[32];
+    for (int n = 0; n < 32; n++) {
+        a[n] = V();
+        b[n] = V();
+    }
+    V* left = a;
+    V* right = b;
+
+    // Subkeys gathered once per batch rather than in every round
+    V roundKey[16][48];
+    for (int r = 0; r < 16; r++) {
+        for (int j = 0; j < 48; j++) roundKey[r][j] = key[DES_SCHEDULE.keyBit[r][j]];
+    }
+
+    for (int iter = 0; iter < 25; iter++) {
+        for (int r = 0; r < 16; r += 2) {
+            desRoundBitsliced(left, right, roundKey[r], salt);
+            desRoundBitsliced(right, left, roundKey[r + 1], salt);
+        }
+        V* tmp = left;
+        left = right;
+        right = tmp;
+    }
+
+    // Back to one 64-bit block per lane, through the final permutation
+    uint64_t preout[64][WORDS];
+    for (int n = 0; n < 32; n++) {
+        memcpy(preout[n], &left[n], sizeof(V));
+        memcpy(preout[32 + n], &right[n], sizeof(V));
+    }
+
+    for (int l = 0; l < count; l++) {
+        uint64_t block = 0;
+        for (int i = 0; i < 64; i++) {
+            block = (block << 1) | ((preout[DES_FP[i] - 1][l / 64] >> (l % 64)) & 1);
+        }
+        desEncode(block, salts[l], out[l]);
+    }
+}
+
+#endif
@@ -1,32 +1,276 @@
 #include <iostream>
 #include <string>
-#include <ctime>
-#include "des.h" 
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/random.h>
+#include "des.h"
 
 using namespace std;
 
+// Widest bitsliced kernel this build can run natively
+#ifdef __AVX2__
+typedef des_v256 des_batch_t;
+#else
+typedef des_v128 des_batch_t;
+#endif
+const int BATCH_LANES = sizeof(des_batch_t) * 8;
+
+// crypt(3) salts are two characters from this 64-char alphabet (12 bits)
+const char saltChars[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+// Salts come from the kernel CSPRNG, not rand()
 string getSalt() {
-    string hexChars = "0123456789ABCDEF";
+    unsigned char bytes[2];
+    if (getrandom(bytes, sizeof(bytes), 0) != sizeof(bytes)) {
+        perror("getrandom");
+        exit(1);
+    }
     string salt = "";
-    for(int i = 0; i < 4; i++) {
-        salt += hexChars[rand() % 16];
+    for(int i = 0; i < 2; i++) {
+        salt += saltChars[bytes[i] & 63];
     }
     return salt;
 }
 
-int main() {
-    srand(time(0));
+// ---------------------------------------------------------------------
+// Audit mode: every word of a wordlist is hashed with every salt found in
+// the target list and looked up in a hash table of the target hashes.
+// ---------------------------------------------------------------------
+
+struct Target {
+    string user;
+    string hash;
+};
+
+vector<Target> targets;
+unordered_map<string, vector<int>> targetsByHash;   // hash -> indices into targets
+vector<string> salts;                               // distinct target salts
+
+// The wordlist is mapped once and handed out in chunks that end on a
+// newline, so threads stream through it without a reader thread.
+const char* wordData;
+size_t wordSize;
+atomic<size_t> nextChunk(0);
+const size_t CHUNK_SIZE = 256 * 1024;
+
+atomic<uint64_t> wordsDone(0);
+atomic<uint64_t> hashesDone(0);
+mutex foundMutex;
+vector<pair<int, string>> found;   // (target index, password)
+
+bool loadTargets(const char* file) {
+    FILE* f = fopen(file, "r");
+    if (f == NULL) return false;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        // Either a bare hash or "user:hash[:...]" like /etc/shadow
+        Target t;
+        char* colon = strchr(line, ':');
+        if (colon != NULL) {
+            *colon = '\0';
+            t.user = line;
+            char* end = strchr(colon + 1, ':');
+            if (end != NULL) *end = '\0';
+            t.hash = colon + 1;
+        } else {
+            t.hash = line;
+            t.user = "#" + to_string(targets.size() + 1);
+        }
+        if (t.hash.size() != DES_HASH_SIZE - 1) continue;
+
+        string salt = t.hash.substr(0, 2);
+        bool known = false;
+        for (const string& s : salts) {
+            if (s == salt) known = true;
+        }
+        if (!known) salts.push_back(salt);
+
+        targetsByHash[t.hash].push_back(targets.size());
+        targets.push_back(t);
+    }
+    fclose(f);
+    return true;
+}
+
+// Claims the next chunk of the wordlist, moved forward to whole lines
+bool nextWords(const char*& begin, const char*& end) {
+    while (true) {
+        size_t start = nextChunk.fetch_add(CHUNK_SIZE);
+        if (start >= wordSize) return false;
+        size_t stop = min(start + CHUNK_SIZE, wordSize);
+
+        // A chunk owns every line that starts inside it
+        if (start > 0) {
+            const char* nl = (const char*)memchr(wordData + start - 1, '\n', stop - start + 1);
+            if (nl == NULL) continue;
+            start = nl - wordData + 1;
+        }
+        if (stop < wordSize) {
+            const char* nl = (const char*)memchr(wordData + stop - 1, '\n', wordSize - stop + 1);
+            stop = nl == NULL ? wordSize : nl - wordData + 1;
+        }
+        if (start >= stop) continue;
+
+        begin = wordData + start;
+        end = wordData + stop;
+        return true;
+    }
+}
+
+void auditWorker() {
+    // One batch = BATCH_LANES (word, salt) pairs, all fixed buffers
+    char passwords[BATCH_LANES][9];
+    const char* pwPtr[BATCH_LANES];
+    const char* saltPtr[BATCH_LANES];
+    const char* wordStart[BATCH_LANES];
+    int wordLen[BATCH_LANES];
+    char hashes[BATCH_LANES][DES_HASH_SIZE];
+    int lanes = 0;
+
+    for (int l = 0; l < BATCH_LANES; l++) pwPtr[l] = passwords[l];
+
+    auto flush = [&]() {
+        desCryptBitsliced<des_batch_t>(pwPtr, saltPtr, hashes, lanes);
+        for (int l = 0; l < lanes; l++) {
+            auto it = targetsByHash.find(string(hashes[l], DES_HASH_SIZE - 1));
+            if (it == targetsByHash.end()) continue;
+            lock_guard<mutex> lock(foundMutex);
+            for (int idx : it->second) {
+                found.push_back(make_pair(idx, string(wordStart[l], wordLen[l])));
+            }
+        }
+        hashesDone += lanes;
+        lanes = 0;
+    };
+
+    const char* begin;
+    const char* end;
+    while (nextWords(begin, end)) {
+        uint64_t words = 0;
+        const char* p = begin;
+        while (p < end) {
+            const char* nl = (const char*)memchr(p, '\n', end - p);
+            const char* lineEnd = nl ? nl : end;
+            int len = lineEnd - p;
+            if (len > 0 && p[len - 1] == '\r') len--;
+
+            if (len > 0) {
+                words++;
+                // DES only looks at the first 8 characters
+                int keyLen = min(len, 8);
+                for (const string& salt : salts) {
+                    memcpy(passwords[lanes], p, keyLen);
+                    passwords[lanes][keyLen] = '\0';
+                    saltPtr[lanes] = salt.c_str();
+                    wordStart[lanes] = p;
+                    wordLen[lanes] = len;
+                    if (++lanes == BATCH_LANES) flush();
+                }
+            }
+            p = lineEnd + 1;
+        }
+        wordsDone += words;
+    }
+    if (lanes > 0) flush();
+}
+
+int runAudit(const char* wordlist, const char* targetFile, int numThreads) {
+    if (!loadTargets(targetFile)) {
+        cout << "Error: Could not open " << targetFile << endl;
+        return 1;
+    }
+    if (targets.empty()) {
+        cout << "Error: No crypt(3) hashes found in " << targetFile << endl;
+        return 1;
+    }
+
+    int fd = open(wordlist, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        cout << "Error: Could not open " << wordlist << endl;
+        return 1;
+    }
+    wordSize = st.st_size;
+    if (wordSize > 0) {
+        void* data = mmap(NULL, wordSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("mmap");
+            return 1;
+        }
+        madvise(data, wordSize, MADV_SEQUENTIAL);
+        wordData = (const char*)data;
+    }
+    close(fd);
+
+    cout << "Targets: " << targets.size() << " hash(es), " << salts.size() << " distinct salt(s)" << endl;
+    cout << "Threads: " << numThreads << ", " << BATCH_LANES << " lanes per batch" << endl;
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(thread(auditWorker));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (wordSize > 0) munmap((void*)wordData, wordSize);
+
+    cout << "\nCracked:" << endl;
+    vector<bool> cracked(targets.size(), false);
+    for (auto const& [idx, password] : found) {
+        if (cracked[idx]) continue;
+        cracked[idx] = true;
+        cout << targets[idx].user << "\t" << targets[idx].hash << "\t" << password << endl;
+    }
+
+    int crackedCount = 0;
+    for (bool c : cracked) crackedCount += c;
+
+    if (seconds <= 0) seconds = 1e-9;
+    cout << "\n" << crackedCount << " of " << targets.size() << " target(s) cracked" << endl;
+    cout << wordsDone.load() << " candidates in " << seconds << " s: "
+         << (uint64_t)(wordsDone.load() / seconds) << " candidates/sec, "
+         << (uint64_t)(hashesDone.load() / seconds) << " hashes/sec" << endl;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--audit") == 0) {
+        if (argc < 4) {
+            cout << "Usage: " << argv[0] << " --audit <wordlist> <targets> [threads]" << endl;
+            return 1;
+        }
+        int numThreads = thread::hardware_concurrency();
+        if (argc >= 5) numThreads = atoi(argv[4]);
+        if (numThreads < 1) numThreads = 1;
+        return runAudit(argv[2], argv[3], numThreads);
+    }
+
     string rawPasswords[10] = {"ahmed24", "ahmed24", "admin", "secure", "root", "user1", "test", "last", "hello", "demo"};
-    
+
     cout << "User\tSalt\tEncrypted (25x DES)\n";
     for(int i = 0; i < 10; i++) {
         string salt = getSalt();
-        string currentPass = rawPasswords[i];
-        
-        for(int j = 0; j < 25; j++) {
-            currentPass = encryptDES(currentPass, salt); 
-        }
-        cout << i+1 << "\t" << salt << "\t" << currentPass << endl;
+        char hash[DES_HASH_SIZE];
+
+        // 25 DES encryptions happen inside desCrypt
+        desCrypt(rawPasswords[i].c_str(), salt.c_str(), hash);
+        cout << i+1 << "\t" << salt << "\t" << hash << endl;
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -31,48 +31,57 @@ void* countWords(void* arg) {
     pthread_exit(NULL);
 }
 
-int main() {
-    const int N = 3; 
-    pthread_t threads[N];
-    ThreadData threadData[N];
-    
-    
-    ifstream file("input.txt");
-    if (!file.is_open()) {
-        cout << "Error: Could not open the file named 'input.txt'." << endl;
-        return 1;
-    }
+// Deals the lines out round-robin to numThreads workers and merges
+// their private counts once they are all done.
+map<string, int> runWordCount(const vector<string>& lines, int numThreads) {
+    vector<pthread_t> threads(numThreads);
+    vector<ThreadData> threadData(numThreads);
 
-    
-    string line;
-    int currentThread = 0;
-    while (getline(file, line)) {
-        
-        threadData[currentThread].textLines.push_back(line);
-        
-        
-        currentThread = (currentThread + 1) % N; 
+    for (size_t i = 0; i < lines.size(); i++) {
+        threadData[i % numThreads].textLines.push_back(lines[i]);
     }
-    file.close();
 
     
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; i < numThreads; i++) {
         threadData[i].id = i;
         pthread_create(&threads[i], NULL, countWords, &threadData[i]);
     }
 
     
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; i < numThreads; i++) {
         pthread_join(threads[i], NULL);
     }
 
     
     map<string, int> totalWordCount;
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; i < numThreads; i++) {
         for (auto const& pair : threadData[i].localWordCount) {
             totalWordCount[pair.first] += pair.second;
         }
     }
+    return totalWordCount;
+}
+
+#ifndef SIMULATOR_NO_MAIN
+int main() {
+    const int N = 3; 
+    
+    
+    ifstream file("input.txt");
+    if (!file.is_open()) {
+        cout << "Error: Could not open the file named 'input.txt'." << endl;
+        return 1;
+    }
+
+    
+    vector<string> lines;
+    string line;
+    while (getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+
+    map<string, int> totalWordCount = runWordCount(lines, N);
 
    
     cout << "\n--- Final Word Count ---" << endl;
@@ -81,4 +90,5 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
+#endif